@@ -0,0 +1,19 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include "main.h"
+
+
+// Part of libevocubist, as DNA and BreederSettings write the version into the files they save.
+const QString Company = "c't";
+const QString AppName = "Evo Cubist";
+const QString AppUrl = "http://evo-cubist.googlecode.com/";
+const QString AppAuthor = "Oliver Lau";
+const QString AppAuthorMail = "ola@ct.de";
+const QString AppVersionNoDebug = "1.3";
+const QString AppMinorVersion = ".7-AUTORUN";
+#ifdef QT_NO_DEBUG
+const QString AppVersion = AppVersionNoDebug + AppMinorVersion;
+#else
+const QString AppVersion = AppVersionNoDebug + AppMinorVersion + " [DEBUG]";
+#endif
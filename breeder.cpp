@@ -9,7 +9,9 @@
 #include <QtCore/QDebug>
 #include <QVector>
 #include <QMutexLocker>
+#include <QVarLengthArray>
 #include <limits>
+#include <string.h>
 #include <qmath.h>
 #include "breeder.h"
 #include "individual.h"
@@ -21,13 +23,40 @@ Breeder::Breeder(QThread* parent)
     , mDirty(false)
     , mStopped(true)
     , mMaximumFitnessDelta(std::numeric_limits<quint64>::max())
+    , mSkippedPixels(0)
+    , mCandidates(0)
+    , mMaximumUpdateRate(30)
+    , mEvolvedPending(false)
+    , mCoalescedUpdates(0)
+    , mRevision(0)
+    , mPatchedRevision(0)
+    , mWorkerPool(NULL)
+    , mSteadyState(false)
+    , mSteadyStatePool(NULL)
+    , mMergeOffsprings(false)
+    , mMergedOffsprings(0)
+    , mGenerationLimit(0)
+    , mState(new State())
+    , mAcceptCommands(false)
 {
     /*...*/
 }
 
 
+Breeder::~Breeder()
+{
+    delete mWorkerPool;
+    delete mSteadyStatePool;
+}
+
+
 void Breeder::setOriginalImage(const QImage& original)
 {
+    Command command;
+    command.type = Command::SetOriginalImage;
+    command.image = original;
+    if (enqueue(command))
+        return;
     mOriginal = original.convertToFormat(QImage::Format_ARGB32);;
     mGenerated = QImage(mOriginal.size(), mOriginal.format());
     mDNA.setScale(mOriginal.size());
@@ -47,6 +76,52 @@ void Breeder::generate(void)
     Individual individual(mDNA, mOriginal);
     mFitness = individual.calcFitness();
     mGenerated = individual.generated();
+    mDNA = individual.dna(); // keep the coverage masks rendered on the way
+    ++mRevision;
+    mCompositeCache.invalidate();
+    publish();
+}
+
+
+QSharedPointer<const Breeder::State> Breeder::state(void) const
+{
+    QMutexLocker locker(&mStateMutex);
+    return mState;
+}
+
+
+unsigned long Breeder::generation(void) const
+{
+    QMutexLocker locker(&mStateMutex);
+    return mGeneration;
+}
+
+
+/// only the breeder's thread, or any thread while it is stopped, changes
+/// mGeneration, so that it may read it without taking the lock
+void Breeder::setGenerationLocked(unsigned long generation)
+{
+    QMutexLocker locker(&mStateMutex);
+    mGeneration = generation;
+}
+
+
+/// make the current DNA, image and fitness available to other threads
+void Breeder::publish(void)
+{
+    State* state = new State;
+    state->dna = mDNA;
+    state->image = mGenerated;
+    state->fitness = mFitness;
+    state->selected = mSelected;
+    state->selectedGeneration = mSelectedGenerations;
+    const QSharedPointer<const State> published(state);
+    // the previous state is released outside the lock, as it may hold the last reference
+    QSharedPointer<const State> previous;
+    mStateMutex.lock();
+    previous = mState;
+    mState = published;
+    mStateMutex.unlock();
 }
 
 
@@ -54,55 +129,132 @@ void Breeder::setDNA(const DNA& dna)
 {
     QMutexLocker locker(&mMutex);
     mDNA = mMutation = dna;
-    mGeneration = mSelectedGenerations = dna.generation();
+    setGenerationLocked(dna.generation());
+    mSelectedGenerations = dna.generation();
     mSelected = dna.selected();
     mTotalSeconds = dna.totalSeconds();
     generate();
 }
 
 
+void Breeder::setMaximumUpdateRate(int hz)
+{
+    Q_ASSERT(hz >= 0);
+    mMaximumUpdateRate = hz;
+}
+
+
+void Breeder::setSteadyState(bool enabled)
+{
+    Q_ASSERT(!isRunning());
+    mSteadyState = enabled;
+}
+
+
+void Breeder::setMergingOffsprings(bool enabled)
+{
+    Q_ASSERT(!isRunning());
+    mMergeOffsprings = enabled;
+}
+
+
+void Breeder::setGenerationLimit(unsigned long generation)
+{
+    Q_ASSERT(!isRunning());
+    mGenerationLimit = generation;
+}
+
+
 void Breeder::setGeneration(unsigned long generation)
 {
-    mGeneration = mSelectedGenerations = generation;
+    setGenerationLocked(generation);
+    mSelectedGenerations = generation;
+    publish();
 }
 
 
 void Breeder::setSelected(unsigned long selected)
 {
     mSelected = selected;
+    publish();
 }
 
 
 void Breeder::spliceAt(const QPointF& p)
+{
+    Command command;
+    command.type = Command::SpliceAt;
+    command.point = p;
+    if (!enqueue(command))
+        splice(p);
+}
+
+
+void Breeder::splice(const QPointF& p)
 {
     if (gSettings.minPointsPerGene() > 3)
         return;
     QMutexLocker locker(&mMutex);
-    int i = mDNA.size();
-    while (i--) {
-        const Gene gene = mDNA.at(i);
-        if (gene.polygon().containsPoint(p, Qt::OddEvenFill)) {
-            QVector<Gene> offsprings =  gene.splice();
-            if (offsprings.size() > 0) {
-                mDNA[i] = offsprings.first();
-                for (int j = 1; j < offsprings.size(); ++j)
-                    mDNA.insert(i, offsprings.at(j));
-                emit spliced(gene, offsprings);
-                mMutation = mDNA;
-                generate();
-                emit evolved(mGenerated, mDNA, mFitness, mSelected, mSelectedGenerations);
-            }
-            break;
-        }
+    const int i = mDNA.geneAt(p, Qt::OddEvenFill);
+    if (i < 0)
+        return;
+    const Gene gene = mDNA.at(i);
+    QVector<Gene> offsprings =  gene.splice();
+    if (offsprings.size() > 0) {
+        mDNA.replace(i, offsprings.first());
+        for (int j = 1; j < offsprings.size(); ++j)
+            mDNA.insert(i, offsprings.at(j));
+        emit spliced(gene, offsprings);
+        mMutation = mDNA;
+        generate();
+        emit evolved(mGenerated, mDNA, mFitness, mSelected, mSelectedGenerations);
     }
 }
 
 
+void Breeder::immigrate(const DNA& dna)
+{
+    Command command;
+    command.type = Command::Immigrate;
+    command.dna = dna;
+    if (!enqueue(command))
+        adopt(dna);
+}
+
+
+void Breeder::adopt(const DNA& dna)
+{
+    if (dna.scale() != mOriginal.size())
+        return;
+    Individual individual(dna, mOriginal);
+    const quint64 fitness = individual.calcFitness();
+    if (fitness >= mFitness)
+        return;
+    mMutex.lock();
+    mDNA = mMutation = individual.dna();
+    mGenerated = individual.generated();
+    mFitness = fitness;
+    ++mRevision;
+    mCompositeCache.invalidate();
+    mDirty = true;
+    mMutex.unlock();
+    publish();
+    mEvolvedPending = true;
+    notify(true);
+}
+
+
 void Breeder::reset(void)
 {
-    mGeneration = mSelectedGenerations = mSelected = 1;
-    mDirty = mStopped = false;
+    // mStopped is left alone, as this may be replayed by a running breeder, see runCommands()
+    setGenerationLocked(1);
+    mSelectedGenerations = mSelected = 1;
+    mDirty = false;
     mTotalSeconds = 0;
+    mSkippedPixels = mCandidates = 0;
+    mCoalescedUpdates = 0;
+    mMergedOffsprings = 0;
+    mEvolvedPending = false;
     populate();
     generate();
     emit evolved(mGenerated, mDNA, mFitness, mSelected, mSelectedGenerations);
@@ -207,40 +359,281 @@ void Breeder::stop(void)
 void Breeder::breed(QThread::Priority priority)
 {
     mStopped = false;
+    mCommandMutex.lock();
+    mAcceptCommands = true;
+    mCommandMutex.unlock();
     start(priority);
 }
 
 
+/// true as long as the breeder has neither been stopped nor reached the generation limit
+bool Breeder::proceeding(void) const
+{
+    return !mStopped && (mGenerationLimit == 0 || mGeneration < mGenerationLimit);
+}
+
+
+/// Breed until stopped or until the generation limit is reached. As one
+/// offspring is bred per core and round, the limit may be overshot by up
+/// to cores-1 generations, or by up to one update interval's worth of
+/// offsprings in steady-state mode.
 void Breeder::run(void)
 {
-    // generate N mutations
-    while (!mStopped) {
+    if (mSteadyState) {
+        breedSteadyState();
+    }
+    else {
+        while (proceeding())
+            proceed();
+    }
+    notify(true);
+    mCommandMutex.lock();
+    mAcceptCommands = false;
+    mCommandMutex.unlock();
+    // from now on edits are carried out right away, but some may be pending
+    runCommands();
+}
+
+
+/// Queue an edit requested by another thread while the breeder is running,
+/// so that the caller does not wait for the current generation to finish.
+/// Returns false if the edit is to be carried out right away.
+bool Breeder::enqueue(const Command& command)
+{
+    QMutexLocker locker(&mCommandMutex);
+    if (!mAcceptCommands || QThread::currentThread() == this)
+        return false;
+    mCommands.append(command);
+    return true;
+}
+
+
+void Breeder::runCommands(void)
+{
+    mCommandMutex.lock();
+    const QVector<Command> commands = mCommands;
+    mCommands.clear();
+    mCommandMutex.unlock();
+    for (QVector<Command>::const_iterator c = commands.constBegin(); c != commands.constEnd(); ++c) {
+        switch (c->type) {
+        case Command::SpliceAt:
+            splice(c->point);
+            break;
+        case Command::SetOriginalImage:
+            setOriginalImage(c->image);
+            break;
+        case Command::Immigrate:
+            adopt(c->dna);
+            break;
+        }
+    }
+}
+
+
+bool Breeder::hasCommands(void)
+{
+    QMutexLocker locker(&mCommandMutex);
+    return !mCommands.isEmpty();
+}
+
+
+/// Breed without a generation barrier until stopped. The workers of the
+/// steady-state pool select offsprings by themselves; this thread merely
+/// collects their progress once per update interval. The pool is paused
+/// to carry out edits and to change the number of cores.
+void Breeder::breedSteadyState(void)
+{
+    while (proceeding()) {
+        runCommands();
         mMutex.lock();
-        const int N = gSettings.cores();
-        QVector<Individual> population(N);
-        for (int i = 0; i < N; ++i)
-            population[i] = Individual(mDNA, mOriginal);
-        QtConcurrent::blockingMap(population, Individual());
-        // find fittest mutation
-        QVector<Individual>::const_iterator best = NULL;
-        for (QVector<Individual>::const_iterator i = population.constBegin(); i != population.constEnd(); ++i) {
-            if (i->fitness() < mFitness) {
-                best = i;
-                mFitness = best->fitness();
-            }
+        mSettings = gSettings.snapshot();
+        if (mSteadyStatePool == NULL || mSteadyStatePool->size() != mSettings.cores) {
+            delete mSteadyStatePool;
+            mSteadyStatePool = new SteadyStatePool(mSettings.cores);
         }
-        // select fittest mutation if any
-        if (best) {
-            mFitness = best->fitness();
-            mDNA = best->dna();
-            mGenerated = best->generated();
-            mDirty = true;
-            mSelectedGenerations = mGeneration + N;
+        quint64 revision = mSteadyStatePool->start(mSettings, mDNA, mOriginal, mGenerated, mFitness);
+        mMutex.unlock();
+        bool restart = false;
+        while (proceeding() && !restart) {
+            // never spin on a core the workers need, even at update rates above 1000 Hz
+            msleep((mMaximumUpdateRate > 0)? qMax(1, 1000 / mMaximumUpdateRate) : 10);
+            const BreederSettings::Snapshot& settings = gSettings.snapshot();
+            restart = (settings.cores != mSettings.cores) || hasCommands();
+            mSettings = settings;
+            mSteadyStatePool->setSettings(mSettings);
+            collect(revision);
         }
+        mSteadyStatePool->stop();
+        collect(revision);
+    }
+}
+
+
+/// take over the offsprings bred and the parent selected by the steady-state pool since the last call
+void Breeder::collect(quint64& revision)
+{
+    setGenerationLocked(mGeneration + mSteadyStatePool->takeBred());
+    const QSharedPointer<const SteadyStatePool::Parent>& parent = mSteadyStatePool->parent();
+    if (parent->revision != revision) {
+        mMutex.lock();
+        mDNA = parent->dna;
+        mGenerated = parent->image;
+        mFitness = parent->fitness;
+        ++mRevision;
+        mCompositeCache.invalidate();
+        mDirty = true;
+        mSelectedGenerations = mGeneration;
         mMutex.unlock();
-        mGeneration += N;
-        emit proceeded(mGeneration);
-        if (best)
-            emit evolved(mGenerated, mDNA, mFitness, ++mSelected, mSelectedGenerations);
+        // every revision of the parent is a selected offspring
+        mSelected += parent->revision - revision;
+        revision = parent->revision;
+        publish();
+        if (mEvolvedPending)
+            ++mCoalescedUpdates;
+        mEvolvedPending = true;
+    }
+    notify();
+}
+
+
+/// Breed in the calling thread until at least the given number of
+/// generations have passed. Must not be called while the thread runs.
+/// Returns the number of generations bred, which is a multiple of the
+/// number of cores.
+unsigned long Breeder::step(unsigned long generations)
+{
+    Q_ASSERT(!isRunning());
+    const unsigned long first = mGeneration;
+    while (mGeneration - first < generations)
+        proceed();
+    notify(true);
+    return mGeneration - first;
+}
+
+
+/// breed one offspring per core and select the fittest one if it beats the current DNA, see mergeWinners()
+void Breeder::proceed(void)
+{
+    runCommands();
+    // generate N mutations
+    mMutex.lock();
+    // changes made to the settings in the meantime take effect from here on
+    mSettings = gSettings.snapshot();
+    const int N = mSettings.cores;
+    // the cache only pays off if the current DNA is likely to survive for a while
+    if (!mCompositeCache.isValid() && mDNA.size() >= CompositeCache::MinGenes && mGeneration - mSelectedGenerations >= CompositeCache::MinStableGenerations)
+        mCompositeCache.build(mDNA, mOriginal.size(), mSettings.backgroundColor);
+    if (mWorkerPool == NULL || mWorkerPool->size() != N) {
+        delete mWorkerPool;
+        mWorkerPool = new WorkerPool(N);
+    }
+    const DNAPatch* patch = (mPatchedRevision == mRevision)? &mSelectedPatch : NULL;
+    mWorkerPool->evolve(mSettings, mDNA, mRevision, patch, mOriginal, mGenerated, mFitness, &mCompositeCache);
+    // find fittest mutation, estimated fitnesses must be confirmed by rendering
+    const quint64 parentFitness = mFitness;
+    Individual* best = NULL;
+    mWinners.resize(0);
+    for (int i = 0; i < N; ++i) {
+        Individual& offspring = mWorkerPool->individual(i);
+        if (offspring.isApproximate() && offspring.fitness() < (mMergeOffsprings? parentFitness : mFitness))
+            offspring.evaluate();
+        mSkippedPixels += offspring.skippedPixels();
+        if (offspring.isApproximate())
+            continue;
+        if (mMergeOffsprings && offspring.fitness() < parentFitness)
+            mWinners.append(&offspring);
+        if (offspring.fitness() < mFitness) {
+            best = &offspring;
+            mFitness = best->fitness();
+        }
+    }
+    // select fittest mutation if any
+    int merged = 0;
+    if (best) {
+        mFitness = best->fitness();
+        // only apply the winner's changes instead of copying its DNA
+        mSelectedPatch = best->patch();
+        best->updateGenerated();
+        mGenerated = best->generated();
+        merged = mergeWinners(best, parentFitness);
+        mDNA.apply(mSelectedPatch);
+        mPatchedRevision = ++mRevision;
+        mCompositeCache.invalidate();
+        mDirty = true;
+        mSelectedGenerations = mGeneration + N;
+    }
+    mCandidates += N;
+    mMutex.unlock();
+    setGenerationLocked(mGeneration + N);
+    if (best) {
+        mSelected += 1 + merged;
+        mMergedOffsprings += merged;
+        publish();
+        if (mEvolvedPending)
+            ++mCoalescedUpdates;
+        mEvolvedPending = true;
+    }
+    notify();
+}
+
+
+static bool fitter(const Individual* a, const Individual* b)
+{
+    return a->fitness() < b->fitness();
+}
+
+
+/// Add the changes of the other winners to those of the fittest one,
+/// fittest first, skipping any that touch a gene or a pixel already
+/// changed. Changes to disjoint areas of the image do not interact, so
+/// the fitness of the combination is the parent's fitness minus the
+/// improvements of the winners merged, and the generated image is the
+/// fittest one's with the others' changed areas copied over.
+/// Returns the number of offsprings merged.
+int Breeder::mergeWinners(const Individual* best, quint64 parentFitness)
+{
+    if (mWinners.size() < 2)
+        return 0;
+    qSort(mWinners.begin(), mWinners.end(), fitter);
+    QVarLengthArray<QRect, 16> changed;
+    changed.append(best->changedRect());
+    int merged = 0;
+    for (QVector<Individual*>::const_iterator i = mWinners.constBegin(); i != mWinners.constEnd(); ++i) {
+        Individual* offspring = *i;
+        if (offspring == best)
+            continue;
+        const QRect& rect = offspring->changedRect();
+        bool overlaps = false;
+        for (int j = 0; j < changed.size() && !overlaps; ++j)
+            overlaps = changed.at(j).intersects(rect);
+        if (overlaps || !mSelectedPatch.canMerge(offspring->patch()))
+            continue;
+        mSelectedPatch.merge(offspring->patch());
+        offspring->updateGenerated();
+        const QImage& generated = offspring->generated();
+        for (int y = rect.top(); y <= rect.bottom(); ++y)
+            memcpy(reinterpret_cast<QRgb*>(mGenerated.scanLine(y)) + rect.left(), reinterpret_cast<const QRgb*>(generated.constScanLine(y)) + rect.left(), rect.width() * sizeof(QRgb));
+        mFitness -= parentFitness - offspring->fitness();
+        changed.append(rect);
+        ++merged;
+    }
+    return merged;
+}
+
+
+/// Emit proceeded() and, if an offspring has been selected since, evolved().
+/// Unless forced, nothing is emitted if the last update has been less
+/// than 1/maximumUpdateRate() seconds ago. The next update then carries
+/// the newest state only, so that a fast breeder does not flood the
+/// receivers' event queues with images and DNAs they would never show.
+void Breeder::notify(bool force)
+{
+    if (!force && mMaximumUpdateRate > 0 && mUpdateTimer.isValid() && mUpdateTimer.elapsed() < 1000 / mMaximumUpdateRate)
+        return;
+    mUpdateTimer.start();
+    emit proceeded(mGeneration);
+    if (mEvolvedPending) {
+        mEvolvedPending = false;
+        emit evolved(mGenerated, mDNA, mFitness, mSelected, mSelectedGenerations);
     }
 }
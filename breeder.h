@@ -10,6 +10,9 @@
 #include <QRgb>
 #include <QThread>
 #include <QMutex>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QVector>
 #include <QtCore/QDebug>
 
 #include <limits>
@@ -18,6 +21,9 @@
 #include "gene.h"
 #include "random/mersenne_twister.h"
 #include "breedersettings.h"
+#include "compositecache.h"
+#include "workerpool.h"
+#include "steadystatepool.h"
 #include "helper.h"
 
 
@@ -26,21 +32,57 @@ class Breeder : public QThread
     Q_OBJECT
 
 public:
+    /// Fittest DNA found so far together with its rendering, published
+    /// whenever the breeder selects an offspring. A published state is
+    /// never modified, so other threads may keep it as long as they like.
+    struct State {
+        DNA dna;
+        QImage image;
+        quint64 fitness;
+        unsigned long selected;
+        unsigned long selectedGeneration;
+    };
+
     explicit Breeder(QThread* parent = NULL);
+    ~Breeder();
     void reset(void);
     void populate(void);
 
-    DNA dna(void) { return mDNA; }
+    /// most recently published state, safe to call from any thread
+    QSharedPointer<const State> state(void) const;
+    DNA dna(void) const { return state()->dna; }
+    /// only to be used while the breeder is stopped
     const DNA& constDNA(void) const { return mDNA; }
-    inline const QImage& image(void) const { return mGenerated; }
+    QImage image(void) const { return state()->image; }
     inline const QImage& originalImage(void) const { return mOriginal; }
-    inline unsigned long generation(void) const { return mGeneration; }
-    inline unsigned long selectedGeneration(void) const { return mSelectedGenerations; }
-    inline quint64 currentFitness(void) const { return mFitness; }
+    /// number of offsprings bred so far, safe to call from any thread
+    unsigned long generation(void) const;
+    /// these are taken from the published state, so they are safe to call from any thread
+    inline unsigned long selectedGeneration(void) const { return state()->selectedGeneration; }
+    inline quint64 currentFitness(void) const { return state()->fitness; }
+    inline unsigned long selected(void) const { return state()->selected; }
     inline quint64 worstFitness(void) const { return mMaximumFitnessDelta; }
-    inline unsigned long selected(void) const { return mSelected; }
+    /// average number of pixels per candidate not evaluated thanks to early abort
+    inline qreal averageSkippedPixels(void) const { return (mCandidates > 0)? (qreal)mSkippedPixels / mCandidates : 0; }
+    /// at most this many proceeded() and evolved() signals per second are emitted while breeding, 0 means no limit
+    inline int maximumUpdateRate(void) const { return mMaximumUpdateRate; }
+    void setMaximumUpdateRate(int hz);
+    /// number of selections not signalled by evolved() of their own because a fitter one followed too soon
+    inline unsigned long coalescedUpdates(void) const { return mCoalescedUpdates; }
+    /// breed() without a generation barrier, see SteadyStatePool; step() is always generational
+    inline bool isSteadyState(void) const { return mSteadyState; }
+    void setSteadyState(bool enabled);
+    /// select every offspring fitter than the parent whose changes do not overlap those of a fitter one, not just the fittest
+    inline bool isMergingOffsprings(void) const { return mMergeOffsprings; }
+    void setMergingOffsprings(bool enabled);
+    /// number of offsprings selected in addition to the fittest one of their generation
+    inline unsigned long mergedOffsprings(void) const { return mMergedOffsprings; }
+    /// breed() stops by itself as soon as this generation is reached, 0 means no limit
+    inline unsigned long generationLimit(void) const { return mGenerationLimit; }
+    void setGenerationLimit(unsigned long generation);
 
     void breed(QThread::Priority priority = QThread::LowPriority);
+    unsigned long step(unsigned long generations);
     void generate(void);
     void stop(void);
     bool isDirty(void) const { return mDirty; }
@@ -54,6 +96,8 @@ public:
 public slots:
     void setOriginalImage(const QImage&);
     void spliceAt(const QPointF&);
+    /// continue with the given DNA, e.g. from another island, if it is fitter than the current one
+    void immigrate(const DNA&);
 
 protected:
     void run(void);
@@ -67,14 +111,63 @@ private:
     quint64 mMaximumFitnessDelta;
     unsigned long mSelected;
     quint64 mTotalSeconds;
+    quint64 mSkippedPixels;
+    quint64 mCandidates;
+    int mMaximumUpdateRate;
+    QElapsedTimer mUpdateTimer;
+    bool mEvolvedPending;
+    unsigned long mCoalescedUpdates;
     QImage mOriginal;
     QImage mGenerated;
     DNA mDNA;
     DNA mMutation;
+    /// incremented whenever mDNA changes
+    quint64 mRevision;
+    /// changes that turned revision mPatchedRevision-1 of mDNA into mPatchedRevision
+    DNAPatch mSelectedPatch;
+    quint64 mPatchedRevision;
+    CompositeCache mCompositeCache;
+    WorkerPool* mWorkerPool;
+    bool mSteadyState;
+    bool mMergeOffsprings;
+    unsigned long mMergedOffsprings;
+    unsigned long mGenerationLimit;
+    /// offsprings of the current generation fitter than their parent
+    QVector<Individual*> mWinners;
+    SteadyStatePool* mSteadyStatePool;
+    /// guards nothing but the pointer to the published state and mGeneration
+    mutable QMutex mStateMutex;
+    QSharedPointer<const State> mState;
+    /// edits requested while breeding, carried out between two generations
+    struct Command {
+        enum Type { SpliceAt, SetOriginalImage, Immigrate };
+        Type type;
+        QPointF point;
+        QImage image;
+        DNA dna;
+    };
+    QVector<Command> mCommands;
+    bool mAcceptCommands;
+    QMutex mCommandMutex;
+    /// settings of the generation being bred
+    BreederSettings::Snapshot mSettings;
     QMutex mMutex;
 
 private: // methods
     void draw(void);
+    bool proceeding(void) const;
+    void proceed(void);
+    int mergeWinners(const Individual* best, quint64 parentFitness);
+    void breedSteadyState(void);
+    void collect(quint64& revision);
+    void publish(void);
+    void setGenerationLocked(unsigned long generation);
+    void notify(bool force = false);
+    bool enqueue(const Command&);
+    void runCommands(void);
+    bool hasCommands(void);
+    void splice(const QPointF&);
+    void adopt(const DNA&);
 
 signals:
     void evolved(const QImage&, const DNA&, quint64, unsigned long, unsigned long);
@@ -7,8 +7,10 @@
 #include <QColor>
 #include <QTextStream>
 #include <QTextCodec>
+#include <QMutexLocker>
 #include "breedersettings.h"
 #include "main.h"
+#include "helper.h"
 
 /// global settings object
 BreederSettings gSettings;
@@ -16,12 +18,14 @@ BreederSettings gSettings;
 
 void BreederSettings::setBackgroundColor(QRgb v)
 {
+    QMutexLocker locker(&mMutex);
     mBackgroundColor = v;
 }
 
 
 void BreederSettings::setDeltaR(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= 0);
     Q_ASSERT(v < 256);
     mdR = v;
@@ -30,6 +34,7 @@ void BreederSettings::setDeltaR(int v)
 
 void BreederSettings::setDeltaG(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= 0);
     Q_ASSERT(v < 256);
     mdG = v;
@@ -38,6 +43,7 @@ void BreederSettings::setDeltaG(int v)
 
 void BreederSettings::setDeltaB(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= 0);
     Q_ASSERT(v < 256);
     mdB = v;
@@ -46,6 +52,7 @@ void BreederSettings::setDeltaB(int v)
 
 void BreederSettings::setDeltaA(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= 0);
     Q_ASSERT(v < 256);
     mdA = v;
@@ -54,6 +61,7 @@ void BreederSettings::setDeltaA(int v)
 
 void BreederSettings::setDeltaXY(int v)
 {
+    QMutexLocker locker(&mMutex);
     mdXY = 1e-4 * v;
     Q_ASSERT(mdXY >= 0.0);
     Q_ASSERT(mdXY < 1.0);
@@ -62,6 +70,7 @@ void BreederSettings::setDeltaXY(int v)
 
 void BreederSettings::setMinA(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= 0);
     Q_ASSERT(v < 256);
     mMinA = v;
@@ -70,6 +79,7 @@ void BreederSettings::setMinA(int v)
 
 void BreederSettings::setMaxA(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= 0);
     Q_ASSERT(v < 256);
     mMaxA = v;
@@ -78,6 +88,7 @@ void BreederSettings::setMaxA(int v)
 
 void BreederSettings::setColorMutationProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mColorMutationProbability = v;
 }
@@ -85,6 +96,7 @@ void BreederSettings::setColorMutationProbability(int v)
 
 void BreederSettings::setPointMutationProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mPointMutationProbability = v;
 }
@@ -92,6 +104,7 @@ void BreederSettings::setPointMutationProbability(int v)
 
 void BreederSettings::setPointKillProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mPointKillProbability = v;
 }
@@ -99,6 +112,7 @@ void BreederSettings::setPointKillProbability(int v)
 
 void BreederSettings::setPointEmergenceProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mPointEmergenceProbability = v;
 }
@@ -106,6 +120,7 @@ void BreederSettings::setPointEmergenceProbability(int v)
 
 void BreederSettings::setGeneKillProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mGeneKillProbability = v;
 }
@@ -113,6 +128,7 @@ void BreederSettings::setGeneKillProbability(int v)
 
 void BreederSettings::setGeneMoveProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mGeneMoveProbability = v;
 }
@@ -120,6 +136,7 @@ void BreederSettings::setGeneMoveProbability(int v)
 
 void BreederSettings::setGeneEmergenceProbability(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mGeneEmergenceProbability = v;
 }
@@ -127,6 +144,7 @@ void BreederSettings::setGeneEmergenceProbability(int v)
 
 void BreederSettings::setMinPointsPerGene(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 2);
     Q_ASSERT(v <= mMaxPointsPerGene);
     mMinPointsPerGene = v;
@@ -135,6 +153,7 @@ void BreederSettings::setMinPointsPerGene(int v)
 
 void BreederSettings::setMaxPointsPerGene(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v >= mMinPointsPerGene);
     mMaxPointsPerGene = v;
 }
@@ -142,6 +161,7 @@ void BreederSettings::setMaxPointsPerGene(int v)
 
 void BreederSettings::setMinGenes(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mMinGenes = v;
 }
@@ -149,6 +169,7 @@ void BreederSettings::setMinGenes(int v)
 
 void BreederSettings::setMaxGenes(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mMaxGenes = v;
 }
@@ -156,6 +177,7 @@ void BreederSettings::setMaxGenes(int v)
 
 void BreederSettings::setOnlyConvex(bool v)
 {
+    QMutexLocker locker(&mMutex);
     mOnlyConvex = v;
 }
 
@@ -175,6 +197,7 @@ void BreederSettings::setGPUComputing(bool enabled)
 
 void BreederSettings::setCores(int v)
 {
+    QMutexLocker locker(&mMutex);
     Q_ASSERT(v > 0);
     mCores = v;
 }
@@ -205,6 +228,14 @@ void BreederSettings::setStartDistribution(int index)
 }
 
 
+void BreederSettings::setRenderer(int renderer)
+{
+    QMutexLocker locker(&mMutex);
+    Q_ASSERT(renderer == QPainterRenderer || renderer == ScanlineRenderer);
+    mRenderer = renderer;
+}
+
+
 void BreederSettings::setLogFile(const QString& logFile)
 {
     mLogFile = logFile;
@@ -247,6 +278,36 @@ void BreederSettings::setDNASaveFilenameTemplate(const QString& v)
 }
 
 
+BreederSettings::Snapshot BreederSettings::snapshot(void) const
+{
+    QMutexLocker locker(&mMutex);
+    Snapshot s;
+    s.dXY = mdXY;
+    s.dR = mdR;
+    s.dG = mdG;
+    s.dB = mdB;
+    s.dA = mdA;
+    s.minA = mMinA;
+    s.maxA = mMaxA;
+    s.colorMutationProbability = mColorMutationProbability;
+    s.pointMutationProbability = mPointMutationProbability;
+    s.pointKillProbability = mPointKillProbability;
+    s.pointEmergenceProbability = mPointEmergenceProbability;
+    s.geneKillProbability = mGeneKillProbability;
+    s.geneMoveProbability = mGeneMoveProbability;
+    s.geneEmergenceProbability = mGeneEmergenceProbability;
+    s.minPointsPerGene = mMinPointsPerGene;
+    s.maxPointsPerGene = mMaxPointsPerGene;
+    s.minGenes = mMinGenes;
+    s.maxGenes = mMaxGenes;
+    s.renderer = mRenderer;
+    s.cores = mCores;
+    s.backgroundColor = mBackgroundColor;
+    s.onlyConvex = mOnlyConvex;
+    return s;
+}
+
+
 bool BreederSettings::save(const QString& fileName)
 {
     Q_ASSERT(!fileName.isEmpty());
@@ -288,6 +349,7 @@ bool BreederSettings::save(const QString& fileName)
         << "    <startDistribution>" << mStartDistribution << "</startDistribution>\n"
         << "    <scatterFactor>" << mScatterFactor << "</scatterFactor>\n"
         << "    <cores>" << mCores << "</cores>\n"
+        << "    <renderer>" << mRenderer << "</renderer>\n"
 //      << "    <gpuComputing>" << mGPUComputing << "</gpuComputing>\n"
         << "  </breeder>\n"
         << "  <files>\n"
@@ -317,7 +379,9 @@ bool BreederSettings::load(const QString& fileName)
     bool success = file.open(QIODevice::ReadOnly | QIODevice::Text);
     if (!success)
         return false;
+    mMutex.lock();
     success = read(&file);
+    mMutex.unlock();
     file.close();
     return success;
 }
@@ -603,6 +667,19 @@ void BreederSettings::readStartDistribution(void)
 }
 
 
+void BreederSettings::readRenderer(void)
+{
+    Q_ASSERT(mXml.isStartElement() && mXml.name() == "renderer");
+    bool ok = false;
+    const QString& str = mXml.readElementText();
+    const int v = str.toInt(&ok);
+    if (ok && (v == QPainterRenderer || v == ScanlineRenderer))
+        mRenderer = v;
+    else
+        mXml.raiseError(QObject::tr("invalid renderer: %1").arg(str));
+}
+
+
 void BreederSettings::readScatterFactor(void)
 {
     Q_ASSERT(mXml.isStartElement() && mXml.name() == "scatterFactor");
@@ -700,6 +777,9 @@ void BreederSettings::readBreeder(void)
         else if (mXml.name() == "gpuComputing") {
             readGPUComputing();
         }
+        else if (mXml.name() == "renderer") {
+            readRenderer();
+        }
         else {
             mXml.skipCurrentElement();
         }
@@ -9,6 +9,7 @@
 #include <QRgb>
 #include <QIODevice>
 #include <QXmlStreamReader>
+#include <QMutex>
 
 
 class BreederSettings : public QObject
@@ -16,6 +17,36 @@ class BreederSettings : public QObject
     Q_OBJECT
 
 public:
+    /// Immutable copy of the settings read while breeding. The breeder
+    /// takes one at the start of each generation and passes it down to the
+    /// workers, so they neither race with the slots below nor reload the
+    /// parameters from the settings object inside their loops. Changes made
+    /// while a generation is being bred take effect with the next one.
+    struct Snapshot {
+        qreal dXY;
+        int dR;
+        int dG;
+        int dB;
+        int dA;
+        int minA;
+        int maxA;
+        int colorMutationProbability;
+        int pointMutationProbability;
+        int pointKillProbability;
+        int pointEmergenceProbability;
+        int geneKillProbability;
+        int geneMoveProbability;
+        int geneEmergenceProbability;
+        int minPointsPerGene;
+        int maxPointsPerGene;
+        int minGenes;
+        int maxGenes;
+        int renderer;
+        int cores;
+        QRgb backgroundColor;
+        bool onlyConvex;
+    };
+
     explicit BreederSettings(void)
         : QObject(NULL)
         , mdXY(0.0042)
@@ -38,6 +69,7 @@ public:
         , mMaxGenes(400)
         , mOnlyConvex(false)
         , mStartDistribution(0)
+        , mRenderer(0) // QPainterRenderer
         , mScatterFactor(0.5)
         , mAutoSave(false)
         , mAutoSaveInterval(10)
@@ -69,6 +101,7 @@ public:
     inline int maxGenes(void) const { return mMaxGenes; }
     inline bool onlyConvex(void) const { return mOnlyConvex; }
     inline int startDistribution(void) const {  return mStartDistribution; }
+    inline int renderer(void) const { return mRenderer; }
     inline qreal scatterFactor(void) const { return mScatterFactor; }
     inline int cores(void) const { return mCores; }
     inline bool autoSave(void) const { return mAutoSave; }
@@ -82,6 +115,8 @@ public:
     inline const QString& dnaSaveDirectory(void) const { return mDNASaveDirectory; }
     inline const QString& dnaSaveFilenameTemplate(void) const { return mDNASaveFilenameTemplate; }
 
+    Snapshot snapshot(void) const;
+
     bool save(const QString& fileName);
     bool load(const QString& fileName);
     QString errorString(void) const;
@@ -113,6 +148,7 @@ public slots:
     void setAutoSave(bool);
     void setStopOnAutosave(bool);
     void setStartDistribution(int);
+    void setRenderer(int);
     void setScatterFactor(double);
     void setLogFile(const QString&);
     void setCurrentDNAFile(const QString&);
@@ -143,6 +179,7 @@ private:
     int mMaxGenes;
     bool mOnlyConvex;
     int mStartDistribution;
+    int mRenderer;
     qreal mScatterFactor;
     bool mAutoSave;
     int mAutoSaveInterval; // secs
@@ -158,6 +195,9 @@ private:
     QString mDNASaveFilenameTemplate;
     QRgb mBackgroundColor;
 
+    /// guards the settings copied by snapshot() against the slots
+    mutable QMutex mMutex;
+
     QXmlStreamReader mXml;
 
     void readRecentDNAFile(void);
@@ -177,6 +217,7 @@ private:
     void readMinGenes(void);
     void readMaxGenes(void);
     void readStartDistribution(void);
+    void readRenderer(void);
     void readScatterFactor(void);
     void readAutoSaveEnabled(void);
     void readAutoSaveInterval(void);
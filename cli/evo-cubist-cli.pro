@@ -0,0 +1,16 @@
+# Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+
+QT += core gui xml
+QT -= widgets
+
+TARGET = evo-cubist-cli
+TEMPLATE = app
+
+CONFIG += console warn_on thread qt
+CONFIG -= app_bundle
+
+EVOCUBIST_BUILD_DIR = $$OUT_PWD/..
+include(../evo-cubist-lib.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,347 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QVariantMap>
+#include <QDateTime>
+#include <QTimer>
+#include <QImage>
+#include <QtCore/QDebug>
+#include <cstdio>
+#include <limits>
+#include "qt-json/json.h"
+#include "breeder.h"
+#include "island.h"
+#include "breedersettings.h"
+#include "dna.h"
+#include "main.h"
+#include "random/rnd.h"
+
+
+static const char* Usage =
+        "Usage: evo-cubist-cli [options] [image]\n"
+        "\n"
+        "Breeds a DNA for the given image (or the one named in the settings)\n"
+        "and prints its progress as one JSON object per line.\n"
+        "\n"
+        "Options:\n"
+        "  -settings FILE      load breeder settings from FILE\n"
+        "  -dna FILE           continue breeding the DNA in FILE\n"
+        "  -timeout SECONDS    stop after SECONDS seconds\n"
+        "  -generations N      stop after breeding N generations\n"
+        "  -fitness F          stop as soon as the fitness is F or better\n"
+        "  -out-image FILE     save the generated image to FILE when done\n"
+        "  -out-dna FILE       save the DNA to FILE (.json, .dna or .svg) when done\n"
+        "  -interval MS        print progress every MS milliseconds (default 1000)\n"
+        "  -seed N             seed the random number generators with N instead of the clock\n"
+        "  -steady-state       breed without waiting for all cores after each generation\n"
+        "  -merge              also select fitter offsprings changing other areas than the fittest\n"
+        "  -island NAME        exchange DNAs with the other processes started with the same NAME\n"
+        "  -migration N        send the DNA to the other islands every N generations (default 100)\n"
+        "\n"
+        "At least one of -timeout, -generations and -fitness must be given.\n"
+        "As one offspring is bred per core at a time, up to cores-1 generations\n"
+        "more than N may be bred, or those of one update interval with -steady-state.\n";
+
+
+/// Drives a Breeder without any widgets until one of the budgets is used up.
+class Runner : public QObject
+{
+    Q_OBJECT
+
+public:
+    Runner(void)
+        : mTimeout(0)
+        , mGenerations(0)
+        , mStartGeneration(0)
+        , mFitness(0)
+        , mFinished(false)
+        , mExitCode(0)
+        , mIsland(&mBreeder)
+    { /* ... */ }
+
+    bool init(const QStringList& args);
+
+public slots:
+    void start(void);
+
+private slots:
+    void proceeded(void);
+    void stopped(void);
+    void report(void);
+
+private:
+    Breeder mBreeder;
+    QTimer mReportTimer;
+    QDateTime mStartTime;
+    QString mImageFile;
+    QString mDNAFile;
+    QString mImageOutFile;
+    QString mDNAOutFile;
+    quint64 mTimeout;
+    unsigned long mGenerations;
+    unsigned long mStartGeneration;
+    quint64 mFitness;
+    bool mFinished;
+    int mExitCode;
+    Island mIsland;
+    QString mIslandName;
+
+    void finish(const QString& reason);
+    void print(const QString& event, QVariantMap data = QVariantMap());
+    quint64 elapsedMSecs(void) const;
+};
+
+
+static void fail(const QString& message)
+{
+    QTextStream(stderr) << message << "\n";
+}
+
+
+bool Runner::init(const QStringList& args)
+{
+    bool ok = true;
+    for (int i = 1; i < args.size() && ok; ++i) {
+        const QString& arg = args.at(i);
+        const bool hasValue = (i + 1 < args.size());
+        if (!arg.startsWith("-")) {
+            mImageFile = arg;
+            continue;
+        }
+        if (arg == "-steady-state") {
+            mBreeder.setSteadyState(true);
+            continue;
+        }
+        if (arg == "-merge") {
+            mBreeder.setMergingOffsprings(true);
+            continue;
+        }
+        if (!hasValue) {
+            fail(QString("missing value for %1").arg(arg));
+            return false;
+        }
+        const QString& value = args.at(++i);
+        if (arg == "-settings") {
+            if (!gSettings.load(value)) {
+                fail(QString("cannot load settings '%1': %2").arg(value).arg(gSettings.errorString()));
+                return false;
+            }
+        }
+        else if (arg == "-dna")
+            mDNAFile = value;
+        else if (arg == "-timeout")
+            mTimeout = value.toULongLong(&ok);
+        else if (arg == "-generations")
+            mGenerations = value.toULong(&ok);
+        else if (arg == "-fitness")
+            mFitness = value.toULongLong(&ok);
+        else if (arg == "-out-image")
+            mImageOutFile = value;
+        else if (arg == "-out-dna")
+            mDNAOutFile = value;
+        else if (arg == "-interval")
+            mReportTimer.setInterval(value.toInt(&ok));
+        else if (arg == "-seed") {
+            const unsigned int seed = value.toUInt(&ok);
+            // the initial DNA is drawn from this thread's generator below
+            if (ok)
+                RAND::seed(seed);
+        }
+        else if (arg == "-island")
+            mIslandName = value;
+        else if (arg == "-migration") {
+            const unsigned long generations = value.toULong(&ok);
+            ok = ok && generations > 0;
+            if (ok)
+                mIsland.setInterval(generations);
+        }
+        else {
+            fail(QString("unknown option %1").arg(arg));
+            return false;
+        }
+        if (!ok)
+            fail(QString("invalid value for %1: %2").arg(arg).arg(value));
+    }
+    if (!ok)
+        return false;
+    if (mTimeout == 0 && mGenerations == 0 && mFitness == 0) {
+        fail("no budget given");
+        return false;
+    }
+    if (mImageFile.isEmpty())
+        mImageFile = gSettings.currentImageFile();
+    const QImage image(mImageFile);
+    if (image.isNull()) {
+        fail(QString("cannot load image '%1'").arg(mImageFile));
+        return false;
+    }
+    gSettings.setCurrentImageFile(mImageFile);
+    mBreeder.setOriginalImage(image);
+    if (!mDNAFile.isEmpty()) {
+        DNA dna;
+        if (!dna.load(mDNAFile)) {
+            fail(QString("cannot load DNA '%1': %2").arg(mDNAFile).arg(dna.errorString()));
+            return false;
+        }
+        mBreeder.setDNA(dna);
+        gSettings.setCurrentDNAFile(mDNAFile);
+    }
+    if (!mIslandName.isEmpty() && !mIsland.join(mIslandName)) {
+        fail(QString("cannot join island '%1': %2").arg(mIslandName).arg(mIsland.errorString()));
+        return false;
+    }
+    QObject::connect(&mBreeder, SIGNAL(proceeded(unsigned long)), SLOT(proceeded()));
+    QObject::connect(&mBreeder, SIGNAL(finished()), SLOT(stopped()));
+    QObject::connect(&mReportTimer, SIGNAL(timeout()), SLOT(report()));
+    return true;
+}
+
+
+void Runner::start(void)
+{
+    mStartTime = QDateTime::currentDateTime();
+    mStartGeneration = mBreeder.generation();
+    // the breeder stops by itself once the budget is used up, see stopped()
+    if (mGenerations > 0)
+        mBreeder.setGenerationLimit(mStartGeneration + mGenerations);
+    QVariantMap data;
+    data["image"] = mImageFile;
+    data["width"] = mBreeder.originalImage().width();
+    data["height"] = mBreeder.originalImage().height();
+    data["genes"] = mBreeder.constDNA().size();
+    data["cores"] = gSettings.cores();
+    data["steadyState"] = mBreeder.isSteadyState();
+    // pass it to -seed to repeat the run
+    data["seed"] = RAND::masterSeed();
+    if (!mIslandName.isEmpty()) {
+        data["island"] = mIslandName;
+        data["hub"] = mIsland.isHub();
+    }
+    print("start", data);
+    if (mReportTimer.interval() <= 0)
+        mReportTimer.setInterval(1000);
+    mReportTimer.start();
+    mBreeder.breed();
+}
+
+
+quint64 Runner::elapsedMSecs(void) const
+{
+    return quint64(qMax(Q_INT64_C(0), mStartTime.msecsTo(QDateTime::currentDateTime())));
+}
+
+
+/// called at most maximumUpdateRate() times per second while breeding
+void Runner::proceeded(void)
+{
+    if (mFinished)
+        return;
+    if (mFitness > 0 && mBreeder.state()->fitness <= mFitness)
+        finish("fitness");
+    else if (mTimeout > 0 && elapsedMSecs() >= 1000 * mTimeout)
+        finish("timeout");
+}
+
+
+/// the breeder only stops without being asked to when it has reached its generation limit
+void Runner::stopped(void)
+{
+    if (!mFinished)
+        finish("generations");
+}
+
+
+void Runner::report(void)
+{
+    if (mFinished)
+        return;
+    print("progress");
+    // the breeder may take a while per round on big images
+    if (mTimeout > 0 && elapsedMSecs() >= 1000 * mTimeout)
+        finish("timeout");
+}
+
+
+void Runner::print(const QString& event, QVariantMap data)
+{
+    const quint64 ms = elapsedMSecs();
+    const QSharedPointer<const Breeder::State>& state = mBreeder.state();
+    data["event"] = event;
+    data["generation"] = qulonglong(mBreeder.generation());
+    data["selected"] = qulonglong(state->selected);
+    data["fitness"] = qulonglong(state->fitness);
+    data["coalesced"] = qulonglong(mBreeder.coalescedUpdates());
+    data["merged"] = qulonglong(mBreeder.mergedOffsprings());
+    if (!mIslandName.isEmpty()) {
+        data["neighbours"] = mIsland.neighbours();
+        data["emigrants"] = qulonglong(mIsland.emigrants());
+        data["immigrants"] = qulonglong(mIsland.immigrants());
+    }
+    data["milliseconds"] = qulonglong(ms);
+    data["generationsPerSecond"] = (ms > 0)? qulonglong(1000 * quint64(mBreeder.generation() - mStartGeneration) / ms) : 0;
+    QTextStream out(stdout);
+    out << QtJson::Json::serialize(data) << "\n";
+    out.flush();
+}
+
+
+void Runner::finish(const QString& reason)
+{
+    mFinished = true;
+    mReportTimer.stop();
+    mBreeder.stop();
+    mBreeder.wait();
+    mBreeder.addTotalSeconds(elapsedMSecs() / 1000);
+    QVariantMap data;
+    data["reason"] = reason;
+    if (!mImageOutFile.isEmpty()) {
+        if (mBreeder.image().save(mImageOutFile)) {
+            data["imageFile"] = mImageOutFile;
+        }
+        else {
+            fail(QString("cannot save image to '%1'").arg(mImageOutFile));
+            mExitCode = 2;
+        }
+    }
+    if (!mDNAOutFile.isEmpty()) {
+        DNA dna = mBreeder.dna();
+        if (dna.save(mDNAOutFile, mBreeder.generation(), mBreeder.selected(), mBreeder.currentFitness(), mBreeder.totalSeconds())) {
+            data["dnaFile"] = mDNAOutFile;
+        }
+        else {
+            fail(QString("cannot save DNA to '%1'").arg(mDNAOutFile));
+            mExitCode = 2;
+        }
+    }
+    print("done", data);
+    QCoreApplication::exit(mExitCode);
+}
+
+
+#include "main.moc"
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setOrganizationName(Company);
+    a.setOrganizationDomain(Company);
+    a.setApplicationName(AppName + " CLI");
+    a.setApplicationVersion(AppVersionNoDebug);
+    a.addLibraryPath("plugins");
+    const QStringList& args = a.arguments();
+    if (args.size() < 2 || args.contains("-h") || args.contains("-help")) {
+        QTextStream(stdout) << Usage;
+        return args.size() < 2;
+    }
+    qRegisterMetaType<DNA>("DNA");
+    RAND::initialize();
+    Runner runner;
+    if (!runner.init(args))
+        return 1;
+    QTimer::singleShot(0, &runner, SLOT(start()));
+    return a.exec();
+}
@@ -0,0 +1,181 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QtCore/QDebug>
+#include <string.h>
+#include "compositecache.h"
+#include "helper.h"
+
+
+CompositeCache::CompositeCache(void)
+    : mBackground(0)
+    , mInterval(1)
+    , mValid(false)
+{ /* ... */ }
+
+
+void CompositeCache::build(const DNA& dna, const QSize& size, QRgb background, qint64 memoryBudget)
+{
+    mValid = false;
+    mPrefix.clear();
+    mSuffix.clear();
+    mDNA = dna;
+    mSize = size;
+    mBackground = background;
+    const int n = mDNA.size();
+    const qint64 bytesPerImage = qint64(size.width()) * size.height() * 4 * sizeof(float);
+    if (n == 0 || bytesPerImage == 0)
+        return;
+    const qint64 maxImages = memoryBudget / bytesPerImage;
+    if (maxImages < 2) {
+        qWarning() << "CompositeCache::build(): memory budget of" << memoryBudget << "bytes too small";
+        return;
+    }
+    mInterval = int((2 * qint64(n) + maxImages - 1) / maxImages);
+    const int checkpoints = (n + mInterval - 1) / mInterval;
+    mPrefix.resize(checkpoints);
+    mSuffix.resize(checkpoints);
+    const QRect area(0, 0, size.width(), size.height());
+    QVector<float> composite(4 * size.width() * size.height());
+    // prefixes: background with the genes below on top
+    for (float* p = composite.data(); p < composite.data() + composite.size(); p += 4) {
+        p[0] = qRed(background);
+        p[1] = qGreen(background);
+        p[2] = qBlue(background);
+        p[3] = 1;
+    }
+    for (int k = 0; k < n; ++k) {
+        if (k % mInterval == 0)
+            mPrefix[k / mInterval] = composite;
+        compositeOver(composite.data(), area, mDNA, k);
+    }
+    // suffixes: genes k..n-1 on a transparent background
+    composite.fill(0);
+    for (int k = n - 1; k >= 0; --k) {
+        compositeUnder(composite.data(), area, mDNA, k);
+        if (k % mInterval == 0)
+            mSuffix[k / mInterval] = composite;
+    }
+    mValid = true;
+}
+
+
+qint64 CompositeCache::errorDelta(const QImage& original, const QRect& rect, int k, const DNA& dna, Scratch& scratch) const
+{
+    Q_ASSERT(mValid);
+    Q_ASSERT(k >= 0 && k < mDNA.size());
+    const QRect area = rect & QRect(0, 0, mSize.width(), mSize.height());
+    if (area.isEmpty())
+        return 0;
+    QVector<float>& prefix = scratch.prefix;
+    QVector<float>& suffix = scratch.suffix;
+    prefix.resize(4 * area.width() * area.height());
+    suffix.fill(0, prefix.size());
+    // background and genes 0..k-1
+    const int p = k / mInterval;
+    copyArea(mPrefix.at(p), area, prefix.data());
+    for (int j = p * mInterval; j < k; ++j)
+        compositeOver(prefix.data(), area, mDNA, j);
+    // genes k+1..n-1
+    const int s = (k + mInterval) / mInterval;
+    int bottom = mDNA.size();
+    if (s < mSuffix.size()) {
+        copyArea(mSuffix.at(s), area, suffix.data());
+        bottom = s * mInterval;
+    }
+    for (int j = bottom - 1; j > k; --j)
+        compositeUnder(suffix.data(), area, mDNA, j);
+    return qint64(error(original, area, prefix.constData(), suffix.constData(), dna, k, scratch.composite))
+            - qint64(error(original, area, prefix.constData(), suffix.constData(), mDNA, k, scratch.composite));
+}
+
+
+/// copy the given area out of a full-size composite
+void CompositeCache::copyArea(const QVector<float>& composite, const QRect& area, float* dst) const
+{
+    const float* src = composite.constData() + 4 * (area.top() * mSize.width() + area.left());
+    for (int y = 0; y < area.height(); ++y) {
+        memcpy(dst, src, 4 * sizeof(float) * area.width());
+        dst += 4 * area.width();
+        src += 4 * mSize.width();
+    }
+}
+
+
+/// put gene index of dna on top of the composite dst which covers area
+void CompositeCache::compositeOver(float* dst, const QRect& area, const DNA& dna, int index) const
+{
+    const QVector<uchar>& mask = dna.coverage(index, mSize);
+    const QRect& maskRect = dna.coverageRect(index);
+    const QRect& covered = maskRect & area;
+    if (covered.isEmpty())
+        return;
+    const QRgb color = dna.color(index);
+    const float cr = qRed(color), cg = qGreen(color), cb = qBlue(color);
+    const int alpha = qAlpha(color);
+    for (int y = covered.top(); y <= covered.bottom(); ++y) {
+        const uchar* m = mask.constData() + (y - maskRect.top()) * maskRect.width() + covered.left() - maskRect.left();
+        float* d = dst + 4 * ((y - area.top()) * area.width() + covered.left() - area.left());
+        for (int x = 0; x < covered.width(); ++x, d += 4) {
+            const int c8 = *m++;
+            if (c8 == 0)
+                continue;
+            const float a = (c8 * alpha) / (255.f * 255.f);
+            d[0] = a * cr + (1 - a) * d[0];
+            d[1] = a * cg + (1 - a) * d[1];
+            d[2] = a * cb + (1 - a) * d[2];
+            d[3] = a + (1 - a) * d[3];
+        }
+    }
+}
+
+
+/// put gene index of dna underneath the composite dst which covers area
+void CompositeCache::compositeUnder(float* dst, const QRect& area, const DNA& dna, int index) const
+{
+    const QVector<uchar>& mask = dna.coverage(index, mSize);
+    const QRect& maskRect = dna.coverageRect(index);
+    const QRect& covered = maskRect & area;
+    if (covered.isEmpty())
+        return;
+    const QRgb color = dna.color(index);
+    const float cr = qRed(color), cg = qGreen(color), cb = qBlue(color);
+    const int alpha = qAlpha(color);
+    for (int y = covered.top(); y <= covered.bottom(); ++y) {
+        const uchar* m = mask.constData() + (y - maskRect.top()) * maskRect.width() + covered.left() - maskRect.left();
+        float* d = dst + 4 * ((y - area.top()) * area.width() + covered.left() - area.left());
+        for (int x = 0; x < covered.width(); ++x, d += 4) {
+            const int c8 = *m++;
+            if (c8 == 0)
+                continue;
+            const float a = (c8 * alpha) / (255.f * 255.f) * (1 - d[3]);
+            d[0] += a * cr;
+            d[1] += a * cg;
+            d[2] += a * cb;
+            d[3] += a;
+        }
+    }
+}
+
+
+/// error inside area of suffix over gene index of dna over prefix
+quint64 CompositeCache::error(const QImage& original, const QRect& area, const float* prefix, const float* suffix, const DNA& dna, int index, QVector<float>& composite) const
+{
+    composite.resize(4 * area.width() * area.height());
+    memcpy(composite.data(), prefix, sizeof(float) * composite.size());
+    compositeOver(composite.data(), area, dna, index);
+    quint64 sum = 0;
+    const float* c = composite.constData();
+    const float* s = suffix;
+    for (int y = area.top(); y <= area.bottom(); ++y) {
+        const QRgb* o = reinterpret_cast<const QRgb*>(original.constScanLine(y)) + area.left();
+        for (int x = 0; x < area.width(); ++x, c += 4, s += 4, ++o) {
+            const float t = 1 - s[3];
+            const int red = qBound(0, int(s[0] + t * c[0] + .5f), 255);
+            const int green = qBound(0, int(s[1] + t * c[1] + .5f), 255);
+            const int blue = qBound(0, int(s[2] + t * c[2] + .5f), 255);
+            sum += square(red - qRed(*o)) + square(green - qGreen(*o)) + square(blue - qBlue(*o));
+        }
+    }
+    return sum;
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __COMPOSITECACHE_H_
+#define __COMPOSITECACHE_H_
+
+#include <QtGlobal>
+#include <QImage>
+#include <QRgb>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include "dna.h"
+
+
+/// Premultiplied prefix and suffix composites of a DNA.
+///
+/// As "over" compositing is associative, an image in which only gene k
+/// differs equals suffix(k+1) over gene k over prefix(k). The prefix of
+/// gene k is the background with genes 0..k-1 on top of it, the suffix
+/// holds genes k+1..n-1 on a transparent background. Composites are only
+/// stored for every m-th gene (m being chosen to fit the memory budget);
+/// the ones in between are assembled from the nearest checkpoint.
+///
+/// The coverage masks of the cached genes are rendered by build(), so
+/// errorDelta() may be called from several threads at once. Floating
+/// point compositing rounds differently from the rasterizer, so results
+/// are approximations that need to be verified before use.
+class CompositeCache
+{
+public:
+    CompositeCache(void);
+
+    void build(const DNA& dna, const QSize& size, QRgb background, qint64 memoryBudget = DefaultMemoryBudget);
+    inline void invalidate(void) { mValid = false; }
+    inline bool isValid(void) const { return mValid; }
+    inline int checkpointInterval(void) const { return mInterval; }
+    inline const DNA& dna(void) const { return mDNA; }
+
+    /// buffers for errorDelta(), kept by the caller so that they can be reused
+    struct Scratch {
+        QVector<float> prefix;
+        QVector<float> suffix;
+        QVector<float> composite;
+    };
+
+    /// change of the error inside rect (in pixels) if gene k of the cached DNA was replaced by gene k of dna
+    qint64 errorDelta(const QImage& original, const QRect& rect, int k, const DNA& dna, Scratch& scratch) const;
+    inline qint64 errorDelta(const QImage& original, const QRect& rect, int k, const DNA& dna) const {
+        Scratch scratch;
+        return errorDelta(original, rect, k, dna, scratch);
+    }
+
+    /// bytes the cache may occupy
+    static const qint64 DefaultMemoryBudget = 128 * 1024 * 1024;
+    /// DNAs with fewer genes are rendered faster than the cache can be built
+    static const int MinGenes = 64;
+    /// the cache is rebuilt after each selection, so only build it once selections have become rare
+    static const unsigned int MinStableGenerations = 100;
+
+private:
+    DNA mDNA;
+    QSize mSize;
+    QRgb mBackground;
+    int mInterval;
+    bool mValid;
+    /// mPrefix[i] holds the background and genes 0..i*mInterval-1, mSuffix[i] genes i*mInterval..n-1
+    QVector<QVector<float> > mPrefix;
+    QVector<QVector<float> > mSuffix;
+
+private: // methods
+    void copyArea(const QVector<float>& composite, const QRect& area, float* dst) const;
+    void compositeOver(float* dst, const QRect& area, const DNA& dna, int index) const;
+    void compositeUnder(float* dst, const QRect& area, const DNA& dna, int index) const;
+    quint64 error(const QImage& original, const QRect& area, const float* prefix, const float* suffix, const DNA& dna, int index, QVector<float>& composite) const;
+};
+
+
+#endif // __COMPOSITECACHE_H_
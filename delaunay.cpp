@@ -28,71 +28,56 @@
 
 #include "delaunay.h"
 
-static const qreal REAL_EPSILON = 1.192092896e-7;
+namespace Delaunay {
+
 static const qreal sqrt3 = 1.732050808;
 
+const qreal Triangle::InCircleTolerance = 1e-12;
+
 void Triangle::setCircumCircle()
 {
-    qreal x0 = mVertices[0]->x();
-    const qreal y0 = mVertices[0]->y();
-    qreal x1 = mVertices[1]->x();
-    const qreal y1 = mVertices[1]->y();
-    const qreal x2 = mVertices[2]->x();
-    const qreal y2 = mVertices[2]->y();
-    const qreal y10 = y1 - y0;
-    const qreal y21 = y2 - y1;
-
-    const bool b21zero = y21 > -REAL_EPSILON && y21 < REAL_EPSILON;
-
-    if (y10 > -REAL_EPSILON && y10 < REAL_EPSILON) {
-        if (b21zero) { // All three vertices are on one horizontal line.
-            if (x1 > x0) {
-                if (x2 > x1)
-                    x1 = x2;
-            }
-            else {
-                if (x2 < x0)
-                    x0 = x2;
-            }
-            mCenter.setX((x0 + x1) * 0.5);
-            mCenter.setY(y0);
+    // The center is only needed to sort triangles and to tell when a triangle
+    // is completed. It is computed relative to the first vertex, which
+    // keeps rounding errors small for the big 'super triangle'.
+    const QPointF& a = mVertices[0]->point();
+    const qreal bx = mVertices[1]->x() - a.x();
+    const qreal by = mVertices[1]->y() - a.y();
+    const qreal cx = mVertices[2]->x() - a.x();
+    const qreal cy = mVertices[2]->y() - a.y();
+    const qreal d = 2 * (bx * cy - by * cx);
+    mOrientation = (d > 0)? 1 : (d < 0)? -1 : 0;
+    if (mOrientation == 0) { // All three vertices are on one line, take the circle around the two farthest apart.
+        const QPointF& p0 = mVertices[0]->point();
+        const QPointF& p1 = mVertices[1]->point();
+        const QPointF& p2 = mVertices[2]->point();
+        const qreal d01 = bx * bx + by * by;
+        const qreal d02 = cx * cx + cy * cy;
+        const qreal d12 = (cx - bx) * (cx - bx) + (cy - by) * (cy - by);
+        if (d01 >= d02 && d01 >= d12) {
+            mCenter = (p0 + p1) * 0.5;
+            mR2 = d01 * 0.25;
         }
-        else { // mVertices[0] and mVertices[1] are on one horizontal line.
-            qreal m1 = - (x2 - x1) / y21;
-            qreal mx1 = (x1 + x2) * 0.5;
-            qreal my1 = (y1 + y2) * 0.5;
-            mCenter.setX((x0 + x1) * 0.5);
-            mCenter.setY(m1 * (mCenter.x() - mx1) + my1);
+        else if (d02 >= d12) {
+            mCenter = (p0 + p2) * 0.5;
+            mR2 = d02 * 0.25;
+        }
+        else {
+            mCenter = (p1 + p2) * 0.5;
+            mR2 = d12 * 0.25;
         }
     }
-    else if (b21zero) { // mVertices[1] and mVertices[2] are on one horizontal line.
-        const qreal m0 = - (x1 - x0) / y10;
-        const qreal mx0 = (x0 + x1) * 0.5;
-        const qreal my0 = (y0 + y1) * 0.5;
-        mCenter.setX((x1 + x2) * 0.5);
-        mCenter.setY(m0 * (mCenter.x() - mx0) + my0);
-    }
-    else {	// 'Common' cases, no multiple vertices are on one horizontal line.
-        const qreal m0 = - (x1 - x0) / y10;
-        const qreal m1 = - (x2 - x1) / y21;
-        const qreal mx0 = (x0 + x1) * 0.5;
-        const qreal my0 = (y0 + y1) * 0.5;
-        const qreal mx1 = (x1 + x2) * 0.5;
-        const qreal my1 = (y1 + y2) * 0.5;
-        mCenter.setX((m0 * mx0 - m1 * mx1 + my1 - my0) / (m0 - m1));
-        mCenter.setY(m0 * (mCenter.x() - mx0) + my0);
+    else {
+        const qreal b2 = bx * bx + by * by;
+        const qreal c2 = cx * cx + cy * cy;
+        const qreal ux = (cy * b2 - by * c2) / d;
+        const qreal uy = (bx * c2 - cx * b2) / d;
+        mCenter = QPointF(a.x() + ux, a.y() + uy);
+        mR2 = ux * ux + uy * uy;	// the radius of the circumcircle, squared
     }
 
-    const qreal dx = x0 - mCenter.x();
-    const qreal dy = y0 - mCenter.y();
-
-    mR2 = dx * dx + dy * dy;	// the radius of the circumcircle, squared
-    mR = sqrt(mR2);	// the proper radius
-
-    // Version 1.1: make mR2 slightly higher to ensure that all edges
-    // of co-circular vertices will be caught.
-    // Note that this is a compromise. In fact, the algorithm isn't really
-    // suited for very many co-circular vertices.
+    // Make mR2 slightly higher so that a triangle is never considered
+    // completed too early. Co-circular vertices are taken care of by
+    // circumCircleEncompasses().
     mR2 *= 1.000001;
 }
 
@@ -199,7 +184,7 @@ protected:
 };
 
 
-void Delaunay::triangulate(const VertexSet& vertices, TriangleSet& output)
+void triangulate(const VertexSet& vertices, TriangleSet& output)
 {
     if (vertices.size() < 3)
         return;	// nothing to handle
@@ -225,9 +210,11 @@ void Delaunay::triangulate(const VertexSet& vertices, TriangleSet& output)
     qreal dx = xMax - xMin;
     qreal dy = yMax - yMin;
 
-    // Make the bounding box slightly bigger, just to feel safe.
-    const qreal ddx = 1e-2 * dx;
-    const qreal ddy = 1e-2 * dy;
+    // Make the bounding box a lot bigger. With a tight 'super triangle' some of
+    // its vertices end up inside the circumcircles of triangles on the convex
+    // hull, and these triangles would be missing from the result.
+    const qreal ddx = 1e5 * dx;
+    const qreal ddy = 1e5 * dy;
 
     xMin -= ddx;
     xMax += ddx;
@@ -238,8 +225,8 @@ void Delaunay::triangulate(const VertexSet& vertices, TriangleSet& output)
     dy += 2 * ddy;
 
     // Create a 'super triangle', encompassing all the vertices. We choose an equilateral triangle with horizontal base.
-    // We could have made the 'super triangle' simply very big. However, the algorithm is quite sensitive to
-    // rounding errors, so it's better to make the 'super triangle' just big enough, like we do here.
+    // A very big 'super triangle' used to be prone to rounding errors. Circumcircles are computed relative
+    // to their first vertex and the in-circle test works on differences only, so this is no longer an issue.
     Vertex vSuper[3];
     vSuper[0] = Vertex(xMin - dy * sqrt3 / 3, yMin); // Simple highschool geometry, believe me.
     vSuper[1] = Vertex(xMax + dy * sqrt3 / 3, yMin);
@@ -256,14 +243,21 @@ void Delaunay::triangulate(const VertexSet& vertices, TriangleSet& output)
         // The algorithm also works without this step, but it is an important optimalization for bigger numbers of vertices.
         // It makes the algorithm about five times faster for 2000 vertices, and for 10000 vertices,
         // it's thirty times faster. For smaller numbers, the difference is negligible.
-        TriangleSet::iterator itEnd = remove_if(workset.begin(), workset.end(), triangleIsCompleted(itVertex, output, vSuper));
-
-        EdgeSet edges;
-
+        //
         // A triangle is 'hot' if the current vertex v is inside the circumcircle.
         // Remove all hot triangles, but keep their edges.
-        itEnd = std::remove_if(workset.begin(), itEnd, vertexIsInCircumCircle(itVertex, edges));
-        workset.erase(itEnd, workset.end()); // remove_if doesn't actually remove; we have to do this explicitly.
+        // Elements of a set must not be overwritten, so both kinds are erased
+        // in one pass instead of using remove_if. A completed triangle cannot be hot.
+        const triangleIsCompleted isCompleted(itVertex, output, vSuper);
+        EdgeSet edges;
+        const vertexIsInCircumCircle isHot(itVertex, edges);
+        TriangleSet::iterator it = workset.begin();
+        while (it != workset.end()) {
+            if (isCompleted(*it) || isHot(*it))
+                workset.erase(it++);
+            else
+                ++it;
+        }
 
         // Create new triangles from the edges and the current vertex.
         for (EdgeSet::iterator it = edges.begin(); it != edges.end(); it++)
@@ -277,7 +271,10 @@ void Delaunay::triangulate(const VertexSet& vertices, TriangleSet& output)
 }
 
 
-void Delaunay::trianglesToEdges(const TriangleSet& triangles, EdgeSet& edges)
+static void HandleEdge(const Vertex* p0, const Vertex* p1, EdgeSet& edges);
+
+
+void trianglesToEdges(const TriangleSet& triangles, EdgeSet& edges)
 {
     for (TriangleSet::const_iterator it = triangles.begin(); it != triangles.end(); ++it) {
         HandleEdge(it->vertex(0), it->vertex(1), edges);
@@ -287,7 +284,7 @@ void Delaunay::trianglesToEdges(const TriangleSet& triangles, EdgeSet& edges)
 }
 
 
-void Delaunay::HandleEdge(const Vertex* p0, const Vertex* p1, EdgeSet& edges)
+static void HandleEdge(const Vertex* p0, const Vertex* p1, EdgeSet& edges)
 {
     const Vertex* pV0(NULL);
     const Vertex* pV1(NULL);
@@ -303,3 +300,5 @@ void Delaunay::HandleEdge(const Vertex* p0, const Vertex* p1, EdgeSet& edges)
     // thus leaving only unique edges.
     edges.insert(Edge(pV0, pV1));
 }
+
+} // namespace Delaunay
@@ -19,6 +19,10 @@
 // Delaunay
 // Class to perform Delaunay triangulation on a set of vertices
 //
+// Adapted for evo-cubist by Oliver Lau:
+// - Moved into namespace Delaunay, so that Vertex does not clash with the DNA's vertex type.
+// - Circumcircle tests compare squared distances only, no square roots are taken.
+//
 // Version 1.2 (C) 2005, Sjaak Priester, Amsterdam.
 // - Removed stupid bug in SetY; function wasn't used, so no consequences. Thanks to squat.
 //
@@ -37,6 +41,8 @@
 #include <algorithm>
 #include <math.h>
 
+namespace Delaunay {
+
 ///////////////////
 // Vertex
 
@@ -84,8 +90,8 @@ class Triangle
 public:
     Triangle(const Triangle& tri)
         : mCenter(tri.mCenter)
-        , mR(tri.mR)
         , mR2(tri.mR2)
+        , mOrientation(tri.mOrientation)
     {
         mVertices[0] = tri.mVertices[0];
         mVertices[1] = tri.mVertices[1];
@@ -120,23 +126,51 @@ public:
     inline bool isLeftOf(VertexSet::const_iterator itVertex) const
     {
         // returns true if * itVertex is to the right of the triangle's circumcircle
-        return itVertex->point().x() > (mCenter.x() + mR);
+        const qreal dx = itVertex->point().x() - mCenter.x();
+        return dx > 0 && dx * dx > mR2;
     }
 
     inline bool circumCircleEncompasses(VertexSet::const_iterator itVertex) const
     {
         // Returns true if * itVertex is in the triangle's circumcircle.
-        // A vertex exactly on the circle is also considered to be in the circle.
-        const QPointF& dist = itVertex->point() - mCenter; // the distance between v and the circle center
-        const qreal dist2 = dist.x() * dist.x() + dist.y() * dist.y(); // squared
-        return dist2 <= mR2; // compare with squared radius
+        // A vertex on the circle is considered to be outside of it.
+        const QPointF& p = itVertex->point();
+        if (mOrientation == 0) {
+            // degenerate triangle, compare with the circle around its longest edge
+            const QPointF& dist = p - mCenter;
+            return dist.x() * dist.x() + dist.y() * dist.y() <= mR2;
+        }
+        // Sign of the in-circle determinant, which only takes products of
+        // squared distances and thus needs neither the center nor a square root.
+        const qreal adx = mVertices[0]->x() - p.x();
+        const qreal ady = mVertices[0]->y() - p.y();
+        const qreal bdx = mVertices[1]->x() - p.x();
+        const qreal bdy = mVertices[1]->y() - p.y();
+        const qreal cdx = mVertices[2]->x() - p.x();
+        const qreal cdy = mVertices[2]->y() - p.y();
+        const qreal alift = adx * adx + ady * ady;
+        const qreal blift = bdx * bdx + bdy * bdy;
+        const qreal clift = cdx * cdx + cdy * cdy;
+        const qreal det = alift * (bdx * cdy - cdx * bdy)
+                + blift * (cdx * ady - adx * cdy)
+                + clift * (adx * bdy - bdx * ady);
+        // Treat determinants within the rounding error as zero so that
+        // cocircular vertices are judged alike in all neighbouring triangles;
+        // otherwise the hole to be retriangulated may not be star-shaped.
+        const qreal permanent = alift * (qAbs(bdx * cdy) + qAbs(cdx * bdy))
+                + blift * (qAbs(cdx * ady) + qAbs(adx * cdy))
+                + clift * (qAbs(adx * bdy) + qAbs(bdx * ady));
+        return det * mOrientation > InCircleTolerance * permanent;
     }
 
+    /// relative rounding error of the in-circle determinant
+    static const qreal InCircleTolerance;
+
 protected:
     const Vertex* mVertices[3];	// the three triangle vertices
     QPointF mCenter;			// center of circumcircle
-    qreal mR;			// radius of circumcircle
     qreal mR2;			// radius of circumcircle, squared
+    int mOrientation;		// +1 if the vertices are in counterclockwise order, -1 if clockwise, 0 if on one line
 
     void setCircumCircle(void);
 };
@@ -181,18 +215,13 @@ typedef std::set<Edge> EdgeSet;
 ///////////////////
 // Delaunay
 
-class Delaunay
-{
-public:
-    // Calculate the Delaunay triangulation for the given set of vertices.
-    static void triangulate(const VertexSet& vertices, TriangleSet& output);
+// Calculate the Delaunay triangulation for the given set of vertices.
+void triangulate(const VertexSet& vertices, TriangleSet& output);
 
-    // Put the edges of the triangles in an edgeSet, eliminating double edges.
-    // This comes in useful for drawing the triangulation.
-    static void trianglesToEdges(const TriangleSet& triangles, EdgeSet& edges);
+// Put the edges of the triangles in an edgeSet, eliminating double edges.
+// This comes in useful for drawing the triangulation.
+void trianglesToEdges(const TriangleSet& triangles, EdgeSet& edges);
 
-protected:
-    static void HandleEdge(const Vertex* p0, const Vertex* p1, EdgeSet& edges);
-};
+} // namespace Delaunay
 
 #endif // __DELAUNAY_H_
@@ -8,6 +8,10 @@
 #include <QTextStream>
 #include <QTextCodec>
 #include <QtCore/QDebug>
+#include <QVarLengthArray>
+#include <qnumeric.h>
+#include <string.h>
+#include <algorithm>
 
 #include "qt-json/json.h"
 #include "gene.h"
@@ -16,22 +20,229 @@
 #include "breedersettings.h"
 #include "main.h"
 #include "helper.h"
+#include "rasterizer.h"
 #include "random/rnd.h"
 
 using namespace QtJson;
 
 
-/// deep copy
-DNA::DNA(const DNA& other)
-    : mSize(other.mSize)
-    , mGeneration(other.mGeneration)
-    , mSelected(other.mSelected)
-    , mFitness(other.mFitness)
-    , mTotalSeconds(other.mTotalSeconds)
+/// copy src into dst, reusing the storage held by dst
+template <typename T>
+static inline void copyInto(QVector<T>& dst, const QVector<T>& src)
 {
-    mDNA.reserve(other.mDNA.size());
-    for (DNAType::const_iterator gene = other.mDNA.constBegin(); gene != other.mDNA.constEnd(); ++gene)
-        mDNA.append(*gene);
+    dst.resize(src.size());
+    memcpy(dst.data(), src.constData(), src.size() * sizeof(T));
+}
+
+
+/// Copy other into this DNA. Other than the assignment operator, which
+/// shares the arrays until one of the copies is changed, this copies the
+/// arrays right away into the storage already held. It thus does not
+/// allocate if this DNA held at least as many genes and vertices before.
+void DNA::assign(const DNA& other)
+{
+    mSize = other.mSize;
+    mGeneration = other.mGeneration;
+    mSelected = other.mSelected;
+    mFitness = other.mFitness;
+    mTotalSeconds = other.mTotalSeconds;
+    mDirtyRect = other.mDirtyRect;
+    mMutatedGene = other.mMutatedGene;
+    copyInto(mVertices, other.mVertices);
+    copyInto(mOffsets, other.mOffsets);
+    copyInto(mColors, other.mColors);
+    copyInto(mBounds, other.mBounds);
+    mGrid.assign(other.mGrid);
+    // the masks themselves are shared until a gene's geometry changes
+    mCoverage.resize(other.mCoverage.size());
+    Coverage* coverage = mCoverage.data();
+    for (QVector<Coverage>::const_iterator c = other.mCoverage.constBegin(); c != other.mCoverage.constEnd(); ++c)
+        *coverage++ = *c;
+}
+
+
+Gene DNA::at(int index) const
+{
+    return Gene(polygon(index), QColor::fromRgba(mColors.at(index)));
+}
+
+
+QPolygonF DNA::polygon(int index) const
+{
+    const int n = vertexCount(index);
+    QPolygonF polygon(n);
+    const Vertex* const v = vertices(index);
+    QPointF* const p = polygon.data();
+    for (int i = 0; i < n; ++i)
+        p[i] = v[i];
+    return polygon;
+}
+
+
+void DNA::insert(int index, const Gene& gene)
+{
+    insertVertices(index, gene.polygon().constData(), gene.polygon().size(), gene.color().rgba());
+}
+
+
+/// insert a gene with the n given points in front of gene index
+template <typename T>
+void DNA::insertVertices(int index, const T* points, int n, QRgb color)
+{
+    Q_ASSERT(index >= 0 && index <= size());
+    mGrid.insertAt(index, size());
+    // an empty gene in front of the one at index, then fill in the vertices
+    mOffsets.insert(index, mOffsets.at(index));
+    mColors.insert(index, color);
+    mBounds.insert(index, QRectF());
+    mCoverage.insert(index, Coverage());
+    setVertices(index, points, n);
+}
+
+
+void DNA::replace(int index, const Gene& gene)
+{
+    mColors[index] = gene.color().rgba();
+    setVertices(index, gene.polygon().constData(), gene.polygon().size());
+}
+
+
+void DNA::remove(int index)
+{
+    setVertices<Vertex>(index, NULL, 0);
+    mOffsets.remove(index);
+    mColors.remove(index);
+    mBounds.remove(index);
+    mCoverage.remove(index);
+    mGrid.removeAt(index);
+}
+
+
+/// Move gene from to index to, shifting the genes in between by one. The
+/// geometry does not change, so the gene keeps its coverage mask.
+void DNA::move(int from, int to)
+{
+    Q_ASSERT(from >= 0 && from < size());
+    Q_ASSERT(to >= 0 && to < size());
+    if (from == to)
+        return;
+    Vertex* const v = mVertices.data();
+    int* const offsets = mOffsets.data();
+    const int moved = vertexCount(from);
+    mGrid.remove(from, mBounds.at(from));
+    mGrid.removeAt(from);
+    mGrid.insertAt(to, size() - 1);
+    if (from < to) {
+        // genes from+1..to move down by one gene, their vertices by the moved ones
+        const int last = offsets[to + 1];
+        std::rotate(v + offsets[from], v + offsets[from + 1], v + last);
+        for (int i = from; i < to; ++i)
+            offsets[i] = offsets[i + 1] - moved;
+        offsets[to] = last - moved;
+        std::rotate(mColors.begin() + from, mColors.begin() + from + 1, mColors.begin() + to + 1);
+        std::rotate(mBounds.begin() + from, mBounds.begin() + from + 1, mBounds.begin() + to + 1);
+        std::rotate(mCoverage.begin() + from, mCoverage.begin() + from + 1, mCoverage.begin() + to + 1);
+    }
+    else {
+        // genes to..from-1 move up by one gene, their vertices by the moved ones
+        std::rotate(v + offsets[to], v + offsets[from], v + offsets[from + 1]);
+        for (int i = from; i > to; --i)
+            offsets[i] = offsets[i - 1] + moved;
+        std::rotate(mColors.begin() + to, mColors.begin() + from, mColors.begin() + from + 1);
+        std::rotate(mBounds.begin() + to, mBounds.begin() + from, mBounds.begin() + from + 1);
+        std::rotate(mCoverage.begin() + to, mCoverage.begin() + from, mCoverage.begin() + from + 1);
+    }
+    mGrid.add(to, mBounds.at(to));
+}
+
+
+void DNA::clear(void)
+{
+    mVertices.clear();
+    mOffsets.clear();
+    mOffsets.append(0);
+    mColors.clear();
+    mBounds.clear();
+    mCoverage.clear();
+    mGrid.clear();
+}
+
+
+void DNA::reserve(int size)
+{
+    mOffsets.reserve(size + 1);
+    mColors.reserve(size);
+    mBounds.reserve(size);
+    mCoverage.reserve(size);
+}
+
+
+/// Replace the vertices of gene index by the n given points, moving the
+/// vertices of all genes behind it. points must not point into this DNA.
+template <typename T>
+void DNA::setVertices(int index, const T* points, int n)
+{
+    const int first = mOffsets.at(index);
+    const int last = mOffsets.at(index + 1);
+    const int delta = n - (last - first);
+    if (delta != 0) {
+        const int tail = mVertices.size() - last;
+        if (delta > 0)
+            mVertices.resize(mVertices.size() + delta);
+        Vertex* const v = mVertices.data();
+        memmove(v + first + n, v + last, tail * sizeof(Vertex));
+        if (delta < 0)
+            mVertices.resize(mVertices.size() + delta);
+        int* const offsets = mOffsets.data();
+        for (int i = index + 1; i < mOffsets.size(); ++i)
+            offsets[i] += delta;
+    }
+    Vertex* const v = mVertices.data() + first;
+    for (int i = 0; i < n; ++i)
+        v[i] = points[i];
+    updateBounds(index);
+}
+
+
+/// recalculate the bounding rect of gene index after its geometry has changed
+void DNA::updateBounds(int index)
+{
+    const int n = vertexCount(index);
+    QRectF bounds;
+    if (n > 0) {
+        const Vertex* p = vertices(index);
+        qreal minX = p->x(), maxX = p->x();
+        qreal minY = p->y(), maxY = p->y();
+        for (const Vertex* const pEnd = p + n; p < pEnd; ++p) {
+            minX = qMin(minX, p->x());
+            maxX = qMax(maxX, p->x());
+            minY = qMin(minY, p->y());
+            maxY = qMax(maxY, p->y());
+        }
+        bounds = QRectF(minX, minY, maxX - minX, maxY - minY);
+    }
+    mGrid.update(index, mBounds.at(index), bounds);
+    mBounds[index] = bounds;
+    mCoverage[index].valid = false;
+}
+
+
+const QVector<uchar>& DNA::coverage(int index, const QSize& imageSize) const
+{
+    Coverage& c = mCoverage[index];
+    if (c.valid && c.size == imageSize)
+        return c.mask;
+    c.rect = pixelRect(mBounds.at(index), imageSize);
+    c.mask.fill(0, c.rect.width() * c.rect.height());
+    if (!c.rect.isEmpty()) {
+        Rasterizer r;
+        r.setImageSize(imageSize);
+        r.setClipRect(c.rect);
+        r.drawCoverage(vertices(index), vertexCount(index), c.mask.data(), c.rect.width());
+    }
+    c.size = imageSize;
+    c.valid = true;
+    return c.mask;
 }
 
 
@@ -40,38 +251,403 @@ inline bool DNA::willMutate(unsigned int probability) {
 }
 
 
+/// buffer for the vertices of a convex gene while its hull is being updated
+typedef QVarLengthArray<QPointF, 32> HullBuffer;
+
+
+static inline void appendVertices(HullBuffer& dst, const Vertex* v, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst.append(v[i]);
+}
+
+
+/// true if the current site mutates, gap counts the sites to skip until the next one that does
+static inline bool nextSite(int& gap, int probability)
+{
+    if (gap > 0) {
+        --gap;
+        return false;
+    }
+    gap = RAND::geometric(probability);
+    return true;
+}
+
+
 QPolygonF DNA::findPolygonForPoint(const QPointF& p) const
 {
-    int i = mDNA.size();
-    while (i--) {
-        const Gene& gene = mDNA.at(i);
-        if (gene.polygon().containsPoint(p, Qt::WindingFill))
-            return gene.polygon();
+    const int index = geneAt(p);
+    return (index < 0)? QPolygonF() : polygon(index);
+}
+
+
+int DNA::geneAt(const QPointF& p, Qt::FillRule fillRule) const
+{
+    for (int i = mGrid.geneAt(p, size()); i >= 0; i = mGrid.geneAt(p, i)) {
+        if (mBounds.at(i).contains(p) && polygon(i).containsPoint(p, fillRule))
+            return i;
     }
-    return QPolygonF();
+    return -1;
 }
 
 
-void DNA::mutate(void)
+void DNA::genesIn(const QRectF& area, QVector<int>& result) const
 {
+    mGrid.genesIn(mGrid.cellRange(area), result);
+    // drop the genes that only share a cell with the area
+    int n = 0;
+    for (int i = 0; i < result.size(); ++i) {
+        if (mBounds.at(result.at(i)).intersects(area))
+            result[n++] = result.at(i);
+    }
+    result.resize(n);
+}
+
+
+/// Mutate the DNA with the probabilities and limits of the given settings.
+/// If patch is given, it is cleared and then receives the changes made.
+void DNA::mutate(const BreederSettings::Snapshot& settings, DNAPatch* patch)
+{
+    if (patch != NULL)
+        patch->clear();
+    mDirtyRect = QRectF();
+    mMutatedGene = -1;
+    bool reordered = false;
     // maybe spawn a new gene
-    if (willMutate(gSettings.geneEmergenceProbability()) && mDNA.size() < gSettings.maxGenes())
-        mDNA.append(Gene(true));
+    if (willMutate(settings.geneEmergenceProbability) && size() < settings.maxGenes) {
+        append(Gene(settings));
+        if (patch != NULL)
+            patch->recordInsert(*this, size() - 1);
+        mDirtyRect |= mBounds.last();
+        reordered = true;
+    }
     // maybe kill a gene
-    if (willMutate(gSettings.geneKillProbability()) && mDNA.size() > gSettings.minGenes())
-        mDNA.remove(RAND::rnd(mDNA.size()));
-    if (willMutate(gSettings.geneMoveProbability())) {
-        const int oldIndex = RAND::rnd(mDNA.size());
-        const int newIndex = RAND::rnd(mDNA.size());
+    if (willMutate(settings.geneKillProbability) && size() > settings.minGenes) {
+        const int index = RAND::rnd(size());
+        mDirtyRect |= mBounds.at(index);
+        if (patch != NULL)
+            patch->recordRemove(*this, index);
+        remove(index);
+        reordered = true;
+    }
+    if (willMutate(settings.geneMoveProbability)) {
+        const int oldIndex = RAND::rnd(size());
+        const int newIndex = RAND::rnd(size());
         if (oldIndex != newIndex) {
-            const Gene gene = mDNA.at(oldIndex);
-            mDNA.remove(oldIndex);
-            mDNA.insert(newIndex, gene);
+            // only the stacking order relative to the moved gene changes
+            move(oldIndex, newIndex);
+            if (patch != NULL)
+                patch->recordMove(oldIndex, newIndex);
+            mDirtyRect |= mBounds.at(newIndex);
+            reordered = true;
+        }
+    }
+    // Pick the kernel for the shape of the genes here, so that the loops
+    // over genes and points do not have to consult the settings. Genes
+    // can neither gain nor lose points if all of them are triangles and
+    // must stay triangles, and triangles need not be kept convex.
+    if (settings.minPointsPerGene == 3 && settings.maxPointsPerGene == 3 && points() == 3 * uint(size()))
+        mutateGenes<Triangles>(settings, reordered, patch);
+    else if (settings.onlyConvex)
+        mutateGenes<ConvexPolygons>(settings, reordered, patch);
+    else
+        mutateGenes<AnyPolygons>(settings, reordered, patch);
+}
+
+
+/// Mutate all contained genes. Instead of rolling the dice for every gene
+/// and point, draw the number of genes or points to skip until the next
+/// one that mutates. This picks the same sites with the same probability,
+/// but only costs random numbers for the few sites that actually mutate.
+template <int S>
+void DNA::mutateGenes(const BreederSettings::Snapshot& settings, bool reordered, DNAPatch* patch)
+{
+    int emergenceGap = (S == Triangles)? std::numeric_limits<int>::max() : RAND::geometric(settings.pointEmergenceProbability);
+    int killGap = (S == Triangles)? std::numeric_limits<int>::max() : RAND::geometric(settings.pointKillProbability);
+    int pointGap = RAND::geometric(settings.pointMutationProbability);
+    int colorGap = RAND::geometric(settings.colorMutationProbability);
+    int mutatedGenes = 0;
+    int lastMutated = -1;
+    for (int i = 0; i < size(); ++i) {
+        const bool emerge = (S != Triangles) && nextSite(emergenceGap, settings.pointEmergenceProbability);
+        const bool kill = (S != Triangles) && nextSite(killGap, settings.pointKillProbability);
+        const bool recolor = nextSite(colorGap, settings.colorMutationProbability);
+        if (!emerge && !kill && !recolor) {
+            // the gene keeps its points, so they can be skipped in one go
+            const int points = (S == Triangles)? 3 : vertexCount(i);
+            if (pointGap >= points) {
+                pointGap -= points;
+                continue;
+            }
+        }
+        const QRectF before = mBounds.at(i);
+        if (mutateGene<S>(settings, i, emerge, kill, pointGap, recolor, patch)) {
+            mDirtyRect |= before | mBounds.at(i);
+            lastMutated = i;
+            ++mutatedGenes;
+        }
+    }
+    if (!reordered && mutatedGenes == 1)
+        mMutatedGene = lastMutated;
+}
+
+
+/// Apply the mutations picked by mutate() to gene index. pointGap is the
+/// number of points to skip until the next one to be translated; it is
+/// carried over from gene to gene so that every point mutates with the
+/// same probability. It is counted against the points the gene has after
+/// emergence and kill, which are the ones walked by the translation.
+/// Returns true if the gene has been changed.
+template <int S>
+bool DNA::mutateGene(const BreederSettings::Snapshot& settings, int index, bool emerge, bool kill, int& pointGap, bool recolor, DNAPatch* patch)
+{
+    if (patch != NULL)
+        patch->beginChange(*this, index);
+    bool reshaped = false;
+    // emerge
+    if (emerge && vertexCount(index) < settings.maxPointsPerGene) {
+        const int n = vertexCount(index);
+        const Vertex* const v = vertices(index);
+        const int i = RAND::rnd(n);
+        const int j = (i+1) % n;
+        QPointF newP = (QPointF(v[i]) + QPointF(v[j])) / 2;
+        Gene::randomlyTranslatePoint(newP, settings.dXY);
+        if (S == ConvexPolygons) {
+            HullBuffer hull;
+            appendVertices(hull, v, n);
+            hull.resize(n + 1);
+            setVertices(index, hull.constData(), addToConvexHull(hull.data(), n, &newP, 1));
+        }
+        else {
+            QPolygonF polygon = this->polygon(index);
+            polygon.insert(j, newP);
+            setVertices(index, polygon.constData(), polygon.size());
+        }
+        reshaped = true;
+    }
+    // kill
+    if (kill && vertexCount(index) > settings.minPointsPerGene) {
+        QPolygonF polygon = this->polygon(index);
+        polygon.remove(RAND::rnd(polygon.size()));
+        setVertices(index, polygon.constData(), polygon.size());
+        reshaped = true;
+    }
+    // translate the points left after emergence and kill
+    const int n = (S == Triangles)? 3 : vertexCount(index);
+    int i = pointGap;
+    if (i < n) {
+        // Convex genes are rebuilt from the vertices that stay in place,
+        // which still form a convex polygon, by adding the moved ones to
+        // it one by one. Each of them only affects the edges it can see.
+        const bool convex = (S == ConvexPolygons) && n > 3;
+        HullBuffer hull;
+        QVarLengthArray<QPointF, 8> moved;
+        Vertex* const points = mVertices.data() + mOffsets.at(index);
+        int unmoved = 0;
+        do {
+            QPointF p = points[i];
+            Gene::randomlyTranslatePoint(p, settings.dXY);
+            if (convex) {
+                appendVertices(hull, points + unmoved, i - unmoved);
+                moved.append(p);
+                unmoved = i + 1;
+            }
+            else {
+                points[i] = p;
+            }
+            i += 1 + RAND::geometric(settings.pointMutationProbability);
+        } while (i < n);
+        if (convex) {
+            appendVertices(hull, points + unmoved, n - unmoved);
+            const int m = hull.size();
+            hull.resize(m + moved.size());
+            setVertices(index, hull.constData(), addToConvexHull(hull.data(), m, moved.constData(), moved.size()));
+        }
+        else {
+            updateBounds(index);
+        }
+        reshaped = true;
+    }
+    pointGap = i - n;
+    // change color, which keeps the coverage mask
+    if (recolor) {
+        const QRgb c = mColors.at(index);
+        const int r = RAND::dInt(qRed(c), settings.dR, 0, 255);
+        const int g = RAND::dInt(qGreen(c), settings.dG, 0, 255);
+        const int b = RAND::dInt(qBlue(c), settings.dB, 0, 255);
+        const int a = RAND::dInt(qAlpha(c), settings.dA, settings.minA, settings.maxA);
+        mColors[index] = qRgba(r, g, b, a);
+    }
+    if (patch != NULL) {
+        if (reshaped || recolor)
+            patch->endChange(*this, reshaped);
+        else
+            patch->dropChange();
+    }
+    return reshaped || recolor;
+}
+
+
+/// redo the changes recorded in patch on a copy of the DNA they were recorded on
+void DNA::apply(const DNAPatch& patch)
+{
+    const Vertex* const points = patch.mPoints.constData();
+    for (QVector<DNAPatch::Entry>::const_iterator e = patch.mEntries.constBegin(); e != patch.mEntries.constEnd(); ++e) {
+        switch (e->type) {
+        case DNAPatch::InsertGene:
+            insertVertices(e->index, points + e->newFirst, e->newCount, e->newColor);
+            break;
+        case DNAPatch::RemoveGene:
+            remove(e->index);
+            break;
+        case DNAPatch::MoveGene:
+            move(e->index, e->to);
+            break;
+        case DNAPatch::ChangeGene:
+            if (e->reshaped)
+                setVertices(e->index, points + e->newFirst, e->newCount);
+            mColors[e->index] = e->newColor;
+            break;
+        }
+    }
+}
+
+
+/// undo the changes recorded in patch on the DNA they were recorded on, restoring the coverage masks as well
+void DNA::revert(const DNAPatch& patch)
+{
+    const Vertex* const points = patch.mPoints.constData();
+    QVector<DNAPatch::Entry>::const_iterator e = patch.mEntries.constEnd();
+    while (e != patch.mEntries.constBegin()) {
+        --e;
+        switch (e->type) {
+        case DNAPatch::InsertGene:
+            remove(e->index);
+            break;
+        case DNAPatch::RemoveGene:
+            insertVertices(e->index, points + e->oldFirst, e->oldCount, e->oldColor);
+            mCoverage[e->index] = e->oldCoverage;
+            break;
+        case DNAPatch::MoveGene:
+            move(e->to, e->index);
+            break;
+        case DNAPatch::ChangeGene:
+            if (e->reshaped) {
+                setVertices(e->index, points + e->oldFirst, e->oldCount);
+                mCoverage[e->index] = e->oldCoverage;
+            }
+            mColors[e->index] = e->oldColor;
+            break;
+        }
+    }
+}
+
+
+bool DNAPatch::canMerge(const DNAPatch& other) const
+{
+    // inserting, removing or moving a gene shifts the indices the other patch refers to
+    for (QVector<Entry>::const_iterator o = other.mEntries.constBegin(); o != other.mEntries.constEnd(); ++o) {
+        if (o->type != ChangeGene)
+            return false;
+    }
+    for (QVector<Entry>::const_iterator e = mEntries.constBegin(); e != mEntries.constEnd(); ++e) {
+        if (e->type != ChangeGene)
+            return false;
+        for (QVector<Entry>::const_iterator o = other.mEntries.constBegin(); o != other.mEntries.constEnd(); ++o) {
+            if (o->index == e->index)
+                return false;
         }
     }
-    // mutate all contained genes
-    for (DNAType::iterator gene = mDNA.begin(); gene != mDNA.end(); ++gene)
-        gene->mutate();
+    return true;
+}
+
+
+void DNAPatch::merge(const DNAPatch& other)
+{
+    Q_ASSERT(canMerge(other));
+    const int offset = mPoints.size();
+    mPoints += other.mPoints;
+    for (QVector<Entry>::const_iterator o = other.mEntries.constBegin(); o != other.mEntries.constEnd(); ++o) {
+        Entry e = *o;
+        e.oldFirst += offset;
+        e.newFirst += offset;
+        mEntries.append(e);
+    }
+}
+
+
+/// append the vertices of gene index to mPoints, returning the position of the first one
+int DNAPatch::appendPoints(const DNA& dna, int index)
+{
+    const int first = mPoints.size();
+    const int n = dna.vertexCount(index);
+    mPoints.resize(first + n);
+    memcpy(mPoints.data() + first, dna.vertices(index), n * sizeof(Vertex));
+    return first;
+}
+
+
+void DNAPatch::recordInsert(const DNA& dna, int index)
+{
+    Entry e(InsertGene, index);
+    e.oldColor = e.newColor = dna.color(index);
+    e.newFirst = appendPoints(dna, index);
+    e.newCount = dna.vertexCount(index);
+    e.reshaped = true;
+    mEntries.append(e);
+}
+
+
+void DNAPatch::recordRemove(const DNA& dna, int index)
+{
+    Entry e(RemoveGene, index);
+    e.oldColor = e.newColor = dna.color(index);
+    e.oldFirst = appendPoints(dna, index);
+    e.oldCount = dna.vertexCount(index);
+    e.reshaped = true;
+    e.oldCoverage = dna.mCoverage.at(index);
+    mEntries.append(e);
+}
+
+
+void DNAPatch::recordMove(int from, int to)
+{
+    Entry e(MoveGene, from);
+    e.to = to;
+    mEntries.append(e);
+}
+
+
+/// remember the state of gene index before DNA::mutateGene() changes it
+void DNAPatch::beginChange(const DNA& dna, int index)
+{
+    Entry e(ChangeGene, index);
+    e.oldColor = dna.color(index);
+    e.oldFirst = appendPoints(dna, index);
+    e.oldCount = dna.vertexCount(index);
+    e.oldCoverage = dna.mCoverage.at(index);
+    mEntries.append(e);
+}
+
+
+/// complete the entry opened by beginChange() with the new state of the gene
+void DNAPatch::endChange(const DNA& dna, bool reshaped)
+{
+    Entry& e = mEntries.last();
+    e.newColor = dna.color(e.index);
+    e.reshaped = reshaped;
+    if (reshaped) {
+        e.newFirst = appendPoints(dna, e.index);
+        e.newCount = dna.vertexCount(e.index);
+    }
+}
+
+
+/// discard the entry opened by beginChange() if the gene did not change after all
+void DNAPatch::dropChange(void)
+{
+    mPoints.resize(mEntries.last().oldFirst);
+    mEntries.resize(mEntries.size() - 1);
 }
 
 
@@ -101,9 +677,9 @@ bool DNA::save(QString& filename, unsigned long generation, unsigned long select
             << " \"deltaxy\": " << gSettings.dXY() << ",\n"
             << " \"size\": { \"width\": " << mSize.width() << ", \"height\": " << mSize.height() << " },\n"
             << " \"dna\": [\n";
-        for (DNAType::const_iterator gene = mDNA.constBegin(); gene != mDNA.constEnd(); ++gene) {
-            out << *gene;
-            if ((gene+1) != mDNA.constEnd())
+        for (int i = 0; i < size(); ++i) {
+            out << at(i);
+            if (i + 1 < size())
                 out << ",";
             out << "\n";
         }
@@ -127,15 +703,17 @@ bool DNA::save(QString& filename, unsigned long generation, unsigned long select
             << " <evocubist:deltaxy>" << gSettings.dXY() << "</evocubist:deltaxy>\n"
             << "</desc>\n"
             << " <g transform=\"scale(" << mSize.width() << ", " << mSize.height() << ")\">\n";
-        for (DNAType::const_iterator gene = mDNA.constBegin(); gene != mDNA.constEnd(); ++gene) {
-            if (gene->polygon().isEmpty()) // just in case
+        for (int i = 0; i < size(); ++i) {
+            const int n = vertexCount(i);
+            if (n == 0) // just in case
                 continue;
-            const QColor& c = gene->color();
+            const QColor& c = QColor::fromRgba(mColors.at(i));
+            const Vertex* const v = vertices(i);
             out << "  <path style=\""
                 << "fill-opacity:" << c.alphaF() << ";"
                 << "fill:rgb(" << c.red() << "," << c.green() << "," << c.blue() << ");" << "\""
-                << " d=\"M " << gene->polygon().first().x() << " " << gene->polygon().first().y();
-            for (QPolygonF::const_iterator p = gene->polygon().constBegin() + 1; p != gene->polygon().constEnd(); ++p)
+                << " d=\"M " << v[0].x() << " " << v[0].y();
+            for (const Vertex* p = v + 1; p != v + n; ++p)
                 out << " L " << p->x() << " " << p->y();
             out << " Z\" />\n";
         }
@@ -188,7 +766,7 @@ bool DNA::load(const QString& filename)
                 const QVariantMap& p = point->toMap();
                 polygon << QPointF(p["x"].toDouble(), p["y"].toDouble());
             }
-            mDNA.append(Gene(polygon, color));
+            append(Gene(polygon, color));
         }
     }
     else if (filename.endsWith(".svg")) {
@@ -210,11 +788,53 @@ bool DNA::load(const QString& filename)
 }
 
 
-/// summarize number of points in all contained genes
-unsigned int DNA::points(void) const
+QDataStream& operator<<(QDataStream& out, const DNA& dna)
+{
+    out << dna.scale() << qint32(dna.size());
+    for (int i = 0; i < dna.size(); ++i) {
+        const int n = dna.vertexCount(i);
+        out << quint32(dna.color(i)) << qint32(n);
+        const Vertex* const v = dna.vertices(i);
+        for (int j = 0; j < n; ++j)
+            out << double(v[j].x()) << double(v[j].y());
+    }
+    return out;
+}
+
+
+/// The data may come from another process, so genes with fewer than 3 or
+/// more than maxPointsPerGene() vertices and coordinates that are not
+/// finite set the stream's status to QDataStream::ReadCorruptData. The
+/// DNA is left empty if the status is not QDataStream::Ok.
+QDataStream& operator>>(QDataStream& in, DNA& dna)
 {
-    unsigned int sum = 0;
-    for (DNAType::const_iterator gene = mDNA.constBegin(); gene != mDNA.constEnd(); ++gene)
-        sum += gene->polygon().size();
-    return sum;
+    QSize scale;
+    qint32 genes = 0;
+    in >> scale >> genes;
+    dna.clear();
+    dna.setScale(scale);
+    if (genes < 0)
+        in.setStatus(QDataStream::ReadCorruptData);
+    for (qint32 i = 0; i < genes && in.status() == QDataStream::Ok; ++i) {
+        quint32 color = 0;
+        qint32 n = 0;
+        in >> color >> n;
+        if (n < 3 || n > gSettings.maxPointsPerGene()) {
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        QPolygonF polygon;
+        for (qint32 j = 0; j < n && in.status() == QDataStream::Ok; ++j) {
+            double x = 0, y = 0;
+            in >> x >> y;
+            if (!qIsFinite(x) || !qIsFinite(y))
+                in.setStatus(QDataStream::ReadCorruptData);
+            polygon << QPointF(x, y);
+        }
+        if (in.status() == QDataStream::Ok)
+            dna.append(Gene(polygon, QColor::fromRgba(color)));
+    }
+    if (in.status() != QDataStream::Ok)
+        dna.clear();
+    return in;
 }
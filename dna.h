@@ -8,17 +8,33 @@
 #include <QDateTime>
 #include <QVector>
 #include <QIODevice>
+#include <QDataStream>
+#include <QRectF>
+#include <QRect>
+#include <QSize>
+#include <QRgb>
+#include <QPointF>
+#include <QPolygonF>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QXmlStreamReader>
 #include <QtCore/QDebug>
 #include <limits>
 #include "gene.h"
+#include "vertex.h"
+#include "genegrid.h"
 
 
-typedef QVector<Gene> DNAType;
+class DNAPatch;
 
 
+/// Genes are stored as a structure of arrays: the vertices of all genes
+/// back to back in one buffer, the offset of each gene's first vertex and
+/// one packed ARGB color per gene. Copying a DNA thus copies a handful of
+/// flat arrays instead of one polygon per gene. Gene objects are only
+/// used to pass single genes in and out. The vertices are stored as
+/// QuantizedPoint if the application is built with QUANTIZED_COORDINATES.
+/// A GeneGrid over the bounding rects answers hit tests and area queries.
 class DNA
 {
 public:
@@ -28,33 +44,55 @@ public:
         , mSelected(0)
         , mFitness(std::numeric_limits<quint64>::max())
         , mTotalSeconds(0)
-    { /* ... */ }
+        , mMutatedGene(-1)
+    {
+        mOffsets.append(0);
+    }
     inline ~DNA() { /* ... */ }
-    /// deep copy constructor
-    DNA(const DNA& dna);
+    void assign(const DNA& other);
 
-    void mutate(void);
+    void mutate(const BreederSettings::Snapshot& settings, DNAPatch* patch = NULL);
+    /// mutate according to the current global settings
+    inline void mutate(DNAPatch* patch = NULL) { mutate(gSettings.snapshot(), patch); }
+    void apply(const DNAPatch& patch);
+    void revert(const DNAPatch& patch);
     bool save(QString& filename, unsigned long generation, unsigned long selected, quint64 fitness, quint64 duration);
     bool load(const QString& filename);
     const QString& errorString(void) const { return mErrorString; }
 
-    unsigned int points(void) const;
+    inline unsigned int points(void) const { return mVertices.size(); }
 
     void setScale(const QSize& size) { mSize = size; }
 
-    inline Gene& operator[](int index) { return mDNA[index]; }
-    inline void append(const Gene& gene) { mDNA.append(gene); }
-    inline void clear(void) { mDNA.clear(); }
-    inline int size(void) const { return mDNA.size(); }
-    inline void remove(int index) { mDNA.remove(index); }
-    inline void insert(int index, const Gene& gene) { mDNA.insert(index, gene); }
-    inline void reserve(int size) { mDNA.reserve(size); }
-    inline const Gene& at(int index) const { return mDNA.at(index); }
-    inline DNAType::const_iterator constBegin(void) const  { return mDNA.constBegin(); }
-    inline DNAType::const_iterator constEnd(void) const { return mDNA.constEnd(); }
-    inline DNAType::iterator begin(void) { return mDNA.begin(); }
-    inline DNAType::iterator end(void) { return mDNA.end(); }
+    inline int size(void) const { return mColors.size(); }
+    Gene at(int index) const;
+    inline void append(const Gene& gene) { insert(size(), gene); }
+    void insert(int index, const Gene& gene);
+    void replace(int index, const Gene& gene);
+    void remove(int index);
+    void move(int from, int to);
+    void clear(void);
+    void reserve(int size);
+
+    /// number of vertices of gene index
+    inline int vertexCount(int index) const { return mOffsets.at(index + 1) - mOffsets.at(index); }
+    /// vertices of gene index, valid until the DNA is changed
+    inline const Vertex* vertices(int index) const { return mVertices.constData() + mOffsets.at(index); }
+    QPolygonF polygon(int index) const;
+    inline QRgb color(int index) const { return mColors.at(index); }
+    inline const QRectF& boundingRect(int index) const { return mBounds.at(index); }
+
+    /// Antialiased coverage (0..255) of gene index in an image of the given
+    /// size, covering coverageRect(index). The mask is rendered on first use
+    /// and kept until the geometry changes, so color mutations come for free.
+    const QVector<uchar>& coverage(int index, const QSize& imageSize) const;
+    inline const QRect& coverageRect(int index) const { return mCoverage.at(index).rect; }
+
     inline const QSize& scale(void) const { return mSize; }
+    /// area (in normalized coordinates) touched by the last call to mutate()
+    inline const QRectF& dirtyRect(void) const { return mDirtyRect; }
+    /// index of the only gene changed by the last call to mutate(), -1 if genes were added, removed, moved or more than one gene changed
+    inline int mutatedGene(void) const { return mMutatedGene; }
 
     inline unsigned long generation(void) const { return mGeneration; }
     inline unsigned long selected(void) const { return mSelected; }
@@ -68,20 +106,123 @@ public:
     inline void setTotalSeconds(quint64 v) { mTotalSeconds = v; }
 
     QPolygonF findPolygonForPoint(const QPointF& p) const;
+    /// index of the topmost gene containing p, -1 if there is none
+    int geneAt(const QPointF& p, Qt::FillRule fillRule = Qt::WindingFill) const;
+    /// indexes of the genes whose bounding rect intersects area (in normalized coordinates), bottom to top
+    void genesIn(const QRectF& area, QVector<int>& result) const;
 
 private:
+    friend class DNAPatch;
+
+    struct Coverage {
+        Coverage(void) : valid(false) { /* ... */ }
+        QVector<uchar> mask;
+        QRect rect;
+        QSize size;
+        bool valid;
+    };
+
     QSize mSize;
-    DNAType mDNA;
+    /// gene i owns mVertices[mOffsets[i]] .. mVertices[mOffsets[i+1]-1]
+    QVector<Vertex> mVertices;
+    QVector<int> mOffsets;
+    QVector<QRgb> mColors;
+    QVector<QRectF> mBounds;
+    mutable QVector<Coverage> mCoverage;
+    GeneGrid mGrid;
     QString mErrorString;
     qreal mVersion;
     unsigned long mGeneration;
     unsigned long mSelected;
     quint64 mFitness;
     quint64 mTotalSeconds;
+    QRectF mDirtyRect;
+    int mMutatedGene;
 
     bool willMutate(unsigned int probability);
+    /// shapes of genes the mutation kernels are specialized for
+    enum Shape { AnyPolygons, ConvexPolygons, Triangles };
+    template <int S> void mutateGenes(const BreederSettings::Snapshot& settings, bool reordered, DNAPatch* patch);
+    template <int S> bool mutateGene(const BreederSettings::Snapshot& settings, int index, bool emerge, bool kill, int& pointGap, bool recolor, DNAPatch* patch);
+    template <typename T> void insertVertices(int index, const T* points, int n, QRgb color);
+    template <typename T> void setVertices(int index, const T* points, int n);
+    void updateBounds(int index);
+};
+
+
+/// Journal of the changes made to a DNA by one call to DNA::mutate().
+/// Each entry holds the state of the touched gene before and after the
+/// change, so a patch can be undone on the mutated DNA or applied to
+/// another copy of the unmutated one. Its size scales with the number of
+/// changes, not with the size of the DNA, and clear() keeps the storage.
+class DNAPatch
+{
+public:
+    inline DNAPatch(void) { /* ... */ }
+
+    inline void clear(void) { mEntries.resize(0); mPoints.resize(0); }
+    inline bool isEmpty(void) const { return mEntries.isEmpty(); }
+    inline int size(void) const { return mEntries.size(); }
+
+    /// true if both patches only change genes in place and have no gene in common
+    bool canMerge(const DNAPatch& other) const;
+    /// append the changes of other, which must have been recorded on the same DNA, see canMerge()
+    void merge(const DNAPatch& other);
+
+private:
+    friend class DNA;
+
+    enum Type { InsertGene, RemoveGene, MoveGene, ChangeGene };
+
+    struct Entry {
+        Entry(void) { /* ... */ }
+        Entry(Type type, int index)
+            : type(type)
+            , index(index)
+            , to(index)
+            , oldColor(0)
+            , newColor(0)
+            , oldFirst(0)
+            , oldCount(0)
+            , newFirst(0)
+            , newCount(0)
+            , reshaped(false)
+        { /* ... */ }
+        Type type;
+        /// index of the gene, the old one in case of MoveGene
+        int index;
+        /// new index in case of MoveGene
+        int to;
+        QRgb oldColor;
+        QRgb newColor;
+        /// vertices before and after the change, in mPoints
+        int oldFirst;
+        int oldCount;
+        int newFirst;
+        int newCount;
+        /// false if only the color has changed
+        bool reshaped;
+        /// mask of the gene before the change, restored on revert
+        DNA::Coverage oldCoverage;
+    };
+
+    QVector<Entry> mEntries;
+    QVector<Vertex> mPoints;
+
+    void recordInsert(const DNA& dna, int index);
+    void recordRemove(const DNA& dna, int index);
+    void recordMove(int from, int to);
+    void beginChange(const DNA& dna, int index);
+    void endChange(const DNA& dna, bool reshaped);
+    void dropChange(void);
+    int appendPoints(const DNA& dna, int index);
 };
 
 
+/// binary form of the genes and the scale of a DNA, e.g. to pass it to another process
+QDataStream& operator<<(QDataStream& out, const DNA& dna);
+QDataStream& operator>>(QDataStream& in, DNA& dna);
+
+
 
 #endif // __DNA_H_
@@ -0,0 +1,25 @@
+# Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+
+# Include this file to link libevocubist. Set EVOCUBIST_BUILD_DIR to the
+# directory evo-cubist-lib.pro is built in (e.g. $$OUT_PWD/..) before.
+
+# Island passes DNAs between processes through local sockets
+QT += network
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# must match the setting the library has been built with
+quantized: DEFINES += QUANTIZED_COORDINATES
+
+win32 {
+    CONFIG(debug, debug|release): EVOCUBIST_LIB_DIR = $$EVOCUBIST_BUILD_DIR/debug
+    else: EVOCUBIST_LIB_DIR = $$EVOCUBIST_BUILD_DIR/release
+}
+else {
+    EVOCUBIST_LIB_DIR = $$EVOCUBIST_BUILD_DIR
+}
+
+LIBS += -L$$EVOCUBIST_LIB_DIR -levocubist
+win32-msvc*: PRE_TARGETDEPS += $$EVOCUBIST_LIB_DIR/evocubist.lib
+else: PRE_TARGETDEPS += $$EVOCUBIST_LIB_DIR/libevocubist.a
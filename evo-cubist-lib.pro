@@ -0,0 +1,60 @@
+# Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+
+# libevocubist: the evolution engine without any widgets, see evocubist.h
+
+QT += core gui xml network
+QT -= widgets
+
+TARGET = evocubist
+TEMPLATE = lib
+
+CONFIG += staticlib warn_on thread qt
+
+# qmake CONFIG+=quantized stores vertices as 16 bit fixed point numbers
+quantized: DEFINES += QUANTIZED_COORDINATES
+
+SOURCES += \
+    qt-json/json.cpp \
+    random/mersenne_twister.cpp \
+    random/xoshiro256starstar.cpp \
+    random/rnd.cpp \
+    appinfo.cpp \
+    breeder.cpp \
+    gene.cpp \
+    dna.cpp \
+    genegrid.cpp \
+    svgreader.cpp \
+    breedersettings.cpp \
+    helper.cpp \
+    delaunay.cpp \
+    rasterizer.cpp \
+    fitness.cpp \
+    compositecache.cpp \
+    workerpool.cpp \
+    steadystatepool.cpp \
+    island.cpp
+
+HEADERS += \
+    evocubist.h \
+    qt-json/json.h \
+    random/abstract_random_number_generator.h \
+    random/mersenne_twister.h \
+    random/xoshiro256starstar.h \
+    random/rnd.h \
+    main.h \
+    breeder.h \
+    gene.h \
+    dna.h \
+    genegrid.h \
+    svgreader.h \
+    breedersettings.h \
+    individual.h \
+    helper.h \
+    delaunay.h \
+    rasterizer.h \
+    fitness.h \
+    compositecache.h \
+    workerpool.h \
+    steadystatepool.h \
+    island.h \
+    vertex.h
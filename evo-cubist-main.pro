@@ -17,43 +17,24 @@ ICON = icons/evo-cubist.icns
 
 RC_FILE = evo-cubist.rc
 
+# the evolution engine, see evo-cubist-lib.pro
+EVOCUBIST_BUILD_DIR = $$OUT_PWD
+include(evo-cubist-lib.pri)
+
 SOURCES += \
-    qt-json/json.cpp \
-    random/mersenne_twister.cpp \
-    random/rnd.cpp \
     main.cpp \
     mainwindow.cpp \
     imagewidget.cpp \
     generationwidget.cpp \
-    breeder.cpp \
-    gene.cpp \
-    dna.cpp \
     optionsform.cpp \
-    svgreader.cpp \
-    breedersettings.cpp \
-    helper.cpp \
-    circle.cpp \
     logviewerform.cpp \
     svgviewer.cpp
 
 HEADERS += \
-    qt-json/json.h \
-    random/abstract_random_number_generator.h \
-    random/mersenne_twister.h \
-    random/rnd.h \
-    main.h \
     mainwindow.h \
     imagewidget.h \
     generationwidget.h \
-    breeder.h \
-    gene.h \
-    dna.h \
     optionsform.h \
-    svgreader.h \
-    breedersettings.h \
-    individual.h \
-    helper.h \
-    circle.h \
     logviewerform.h \
     svgviewer.h
 
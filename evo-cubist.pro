@@ -1,8 +1,16 @@
 TEMPLATE = subdirs
-SUBDIRS = evo-cubist-main \
+SUBDIRS = evo-cubist-lib \
+    evo-cubist-main \
+    evo-cubist-cli \
     unit-tests \
     delaunay
 
+evo-cubist-lib.file = evo-cubist-lib.pro
 evo-cubist-main.file = evo-cubist-main.pro
+evo-cubist-cli.file = cli/evo-cubist-cli.pro
 unit-tests.file = test/unit/evo-cubist-test.pro
 delaunay.file = test/delaunay/delaunay.pro
+
+evo-cubist-main.depends = evo-cubist-lib
+evo-cubist-cli.depends = evo-cubist-lib
+unit-tests.depends = evo-cubist-lib
@@ -0,0 +1,29 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __EVOCUBIST_H_
+#define __EVOCUBIST_H_
+
+/// Public interface of libevocubist, the evolution engine without any
+/// widgets. A program linking it (see evo-cubist-lib.pri) typically
+///
+///   gSettings.load("settings.xml");             // configure
+///   Breeder breeder;
+///   breeder.setOriginalImage(QImage("a.png"));  // load image, creates a random DNA
+///   breeder.setDNA(dna);                        // optionally continue an earlier run
+///   breeder.step(10000);                        // breed 10000 generations in this thread
+///   breeder.currentFitness(); breeder.image(); breeder.dna();
+///
+/// or runs the breeder in its own thread with breed() and stop(),
+/// following its progress through the evolved() and proceeded() signals.
+/// An Island lets several such programs exchange their DNAs.
+
+#include "main.h"
+#include "breedersettings.h"
+#include "gene.h"
+#include "dna.h"
+#include "breeder.h"
+#include "island.h"
+
+
+#endif // __EVOCUBIST_H_
@@ -0,0 +1,187 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include "fitness.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define FITNESS_X86
+#define FITNESS_TARGET(t) __attribute__((target(t)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define FITNESS_X86
+#define FITNESS_TARGET(t)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+
+typedef quint64 (*RgbDeltaSumFunc)(const QRgb*, const QRgb*, int);
+
+
+static quint64 rgbDeltaSumScalar(const QRgb* a, const QRgb* b, int n)
+{
+    quint64 sum = 0;
+    const QRgb* const aEnd = a + n;
+    while (a < aEnd)
+        sum += rgbDelta(*a++, *b++);
+    return sum;
+}
+
+
+#ifdef FITNESS_X86
+
+/// Each 32 bit lane gains at most 4*255^2 per iteration, so lanes are
+/// flushed into 64 bit accumulators before they can exceed 2^32.
+static const int MaxIterationsPerBlock = 8192;
+
+
+FITNESS_TARGET("sse2")
+static quint64 rgbDeltaSumSSE2(const QRgb* a, const QRgb* b, int n)
+{
+    const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum64 = _mm_setzero_si128();
+    int i = 0;
+    while (n - i >= 4) {
+        const int blockEnd = i + qMin((n - i) & ~3, 4 * MaxIterationsPerBlock);
+        __m128i sum32 = _mm_setzero_si128();
+        for ( ; i < blockEnd; i += 4) {
+            const __m128i pa = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), rgbMask);
+            const __m128i pb = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), rgbMask);
+            const __m128i dLo = _mm_sub_epi16(_mm_unpacklo_epi8(pa, zero), _mm_unpacklo_epi8(pb, zero));
+            const __m128i dHi = _mm_sub_epi16(_mm_unpackhi_epi8(pa, zero), _mm_unpackhi_epi8(pb, zero));
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(dLo, dLo));
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(dHi, dHi));
+        }
+        sum64 = _mm_add_epi64(sum64, _mm_unpacklo_epi32(sum32, zero));
+        sum64 = _mm_add_epi64(sum64, _mm_unpackhi_epi32(sum32, zero));
+    }
+    quint64 lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum64);
+    return lanes[0] + lanes[1] + rgbDeltaSumScalar(a + i, b + i, n - i);
+}
+
+
+FITNESS_TARGET("avx2")
+static quint64 rgbDeltaSumAVX2(const QRgb* a, const QRgb* b, int n)
+{
+    const __m256i rgbMask = _mm256_set1_epi32(0x00ffffff);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum64 = _mm256_setzero_si256();
+    int i = 0;
+    while (n - i >= 8) {
+        const int blockEnd = i + qMin((n - i) & ~7, 8 * MaxIterationsPerBlock);
+        __m256i sum32 = _mm256_setzero_si256();
+        for ( ; i < blockEnd; i += 8) {
+            const __m256i pa = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), rgbMask);
+            const __m256i pb = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)), rgbMask);
+            const __m256i dLo = _mm256_sub_epi16(_mm256_unpacklo_epi8(pa, zero), _mm256_unpacklo_epi8(pb, zero));
+            const __m256i dHi = _mm256_sub_epi16(_mm256_unpackhi_epi8(pa, zero), _mm256_unpackhi_epi8(pb, zero));
+            sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(dLo, dLo));
+            sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(dHi, dHi));
+        }
+        sum64 = _mm256_add_epi64(sum64, _mm256_unpacklo_epi32(sum32, zero));
+        sum64 = _mm256_add_epi64(sum64, _mm256_unpackhi_epi32(sum32, zero));
+    }
+    quint64 lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sum64);
+    _mm256_zeroupper();
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + rgbDeltaSumScalar(a + i, b + i, n - i);
+}
+
+
+static bool cpuHasAVX2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+
+static bool cpuHasSSE2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif // FITNESS_X86
+
+
+bool fitnessKernelSupported(FitnessKernel kernel)
+{
+    switch (kernel) {
+    case ScalarKernel:
+        return true;
+#ifdef FITNESS_X86
+    case SSE2Kernel:
+        return cpuHasSSE2();
+    case AVX2Kernel:
+        return cpuHasAVX2();
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+
+FitnessKernel bestFitnessKernel(void)
+{
+    if (fitnessKernelSupported(AVX2Kernel))
+        return AVX2Kernel;
+    if (fitnessKernelSupported(SSE2Kernel))
+        return SSE2Kernel;
+    return ScalarKernel;
+}
+
+
+static RgbDeltaSumFunc kernelFunc(FitnessKernel kernel)
+{
+    switch (kernel) {
+#ifdef FITNESS_X86
+    case SSE2Kernel:
+        return rgbDeltaSumSSE2;
+    case AVX2Kernel:
+        return rgbDeltaSumAVX2;
+#endif
+    default:
+        break;
+    }
+    return rgbDeltaSumScalar;
+}
+
+
+// selected once at startup, so that calls need not query the CPU again
+static const RgbDeltaSumFunc bestKernelFunc = kernelFunc(bestFitnessKernel());
+
+
+quint64 rgbDeltaSum(const QRgb* a, const QRgb* b, int n, FitnessKernel kernel)
+{
+    Q_ASSERT(fitnessKernelSupported(kernel));
+    return kernelFunc(kernel)(a, b, n);
+}
+
+
+quint64 rgbDeltaSum(const QRgb* a, const QRgb* b, int n)
+{
+    return bestKernelFunc(a, b, n);
+}
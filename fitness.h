@@ -0,0 +1,36 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __FITNESS_H_
+#define __FITNESS_H_
+
+#include <QtGlobal>
+#include <QRgb>
+
+#include "helper.h"
+
+
+enum FitnessKernel {
+    ScalarKernel = 0,
+    SSE2Kernel = 1,
+    AVX2Kernel = 2
+};
+
+
+/// squared color distance of two pixels; alpha is ignored
+inline unsigned int rgbDelta(QRgb c1, QRgb c2)
+{
+    return square(qRed(c1) - qRed(c2)) + square(qGreen(c1) - qGreen(c2)) + square(qBlue(c1) - qBlue(c2));
+}
+
+/// true if the kernel was compiled in and the CPU is able to run it
+extern bool fitnessKernelSupported(FitnessKernel kernel);
+/// fastest kernel supported by the CPU
+extern FitnessKernel bestFitnessKernel(void);
+/// sum of rgbDelta() over n pixels computed by the given kernel
+extern quint64 rgbDeltaSum(const QRgb* a, const QRgb* b, int n, FitnessKernel kernel);
+/// sum of rgbDelta() over n pixels computed by the fastest kernel available
+extern quint64 rgbDeltaSum(const QRgb* a, const QRgb* b, int n);
+
+
+#endif // __FITNESS_H_
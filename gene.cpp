@@ -7,20 +7,31 @@
 #include "gene.h"
 #include "breedersettings.h"
 #include "random/rnd.h"
-#include "circle.h"
+#include "delaunay.h"
 #include "helper.h"
 
 
 Gene::Gene(bool randomize)
 {
-    if (randomize) {
-        const int N = RAND::rnd(gSettings.minPointsPerGene(), gSettings.maxPointsPerGene());
-        for (int x = 0; x < N; ++x)
-            mPolygon.append(QPointF(RAND::rnd1(), RAND::rnd1()));
-        mColor.setRgb(RAND::rnd(256), RAND::rnd(256), RAND::rnd(256), RAND::rnd(gSettings.minA(), gSettings.maxA()));
-        if (mPolygon.size() > 3 && gSettings.onlyConvex())
-            mPolygon = convexHull(mPolygon);
-    }
+    if (randomize)
+        this->randomize(gSettings.snapshot());
+}
+
+
+Gene::Gene(const BreederSettings::Snapshot& settings)
+{
+    randomize(settings);
+}
+
+
+void Gene::randomize(const BreederSettings::Snapshot& settings)
+{
+    const int N = RAND::rnd(settings.minPointsPerGene, settings.maxPointsPerGene);
+    for (int x = 0; x < N; ++x)
+        mPolygon.append(QPointF(RAND::rnd1(), RAND::rnd1()));
+    mColor.setRgb(RAND::rnd(256), RAND::rnd(256), RAND::rnd(256), RAND::rnd(settings.minA, settings.maxA));
+    if (mPolygon.size() > 3 && settings.onlyConvex)
+        mPolygon = convexHull(mPolygon);
 }
 
 
@@ -69,84 +80,31 @@ QVector<Gene> Gene::bisect(void) const
 }
 
 
-QPolygonF Gene::evaluateTriangle(int i, int j, int k) const
-{
-    Circle circle(mPolygon.at(i), mPolygon.at(j), mPolygon.at(k));
-    for (int w = 0; w < mPolygon.size(); ++w) {
-        if (w == i || w == j || w == k)
-            continue;
-        if (circle.contains(mPolygon.at(w)))
-            return QPolygonF();
-    }
-    QPolygonF result;
-    result << mPolygon.at(i) << mPolygon.at(j) << mPolygon.at(k);
-    return result;
-}
-
-
-/// convert point cloud to triangles (dumb O(n^4) implementation)
+/// convert point cloud to its Delaunay triangulation
 /// see http://de.wikipedia.org/wiki/Delaunay-Triangulation
 QVector<Gene> Gene::triangulize(void) const
 {
     Q_ASSERT(mPolygon.size() > 3);
+    Delaunay::VertexSet vertices;
+    for (QPolygonF::const_iterator p = mPolygon.constBegin(); p != mPolygon.constEnd(); ++p)
+        vertices.insert(Delaunay::Vertex(*p));
+    Delaunay::TriangleSet triangles;
+    Delaunay::triangulate(vertices, triangles);
     QVector<Gene> result;
-    for (int i = 0; i < mPolygon.size()-2; ++i) {
-        for (int j = i + 1; j < mPolygon.size()-1; ++j) {
-            for (int k = j + 1; k < mPolygon.size(); ++k) {
-                const QPolygonF& triangle = evaluateTriangle(i, j, k);
-                if (!triangle.isEmpty())
-                    result << Gene(triangle, mColor);
-            }
-        }
+    result.reserve(triangles.size());
+    for (Delaunay::TriangleSet::const_iterator t = triangles.begin(); t != triangles.end(); ++t) {
+        QPolygonF triangle;
+        triangle << t->vertex(0)->point() << t->vertex(1)->point() << t->vertex(2)->point();
+        result << Gene(triangle, mColor);
     }
     return result;
 }
 
 
-inline bool Gene::willMutate(int probability) const {
-    return RAND::rnd(probability) == 0;
-}
-
-
-void Gene::randomlyTranslatePoint(QPointF& p)
+void Gene::randomlyTranslatePoint(QPointF& p, qreal dXY)
 {
-    p.setX(RAND::dReal(p.x(), gSettings.dXY(), 0.0, 1.0));
-    p.setY(RAND::dReal(p.y(), gSettings.dXY(), 0.0, 1.0));
-}
-
-
-void Gene::mutate(void)
-{
-    // emerge
-    if (willMutate(gSettings.pointEmergenceProbability()) && mPolygon.size() < gSettings.maxPointsPerGene()) {
-        const int i = RAND::rnd(mPolygon.size());
-        const int j = (i+1) % mPolygon.size();
-        const QPointF& p0 = mPolygon.at(i);
-        const QPointF& p1 = mPolygon.at(j);
-        QPointF newP = (p0 + p1) / 2;
-        randomlyTranslatePoint(newP);
-        mPolygon.insert(j, newP);
-        if (gSettings.onlyConvex())
-            mPolygon = convexHull(mPolygon);
-    }
-    // kill
-    if (willMutate(gSettings.pointKillProbability()) && mPolygon.size() > gSettings.minPointsPerGene())
-        mPolygon.remove(RAND::rnd(mPolygon.size()));
-    // translate
-    for (QPolygonF::iterator p = mPolygon.begin(); p != mPolygon.end(); ++p) {
-        if (willMutate(gSettings.pointMutationProbability()))
-            randomlyTranslatePoint(*p);
-        if (mPolygon.size() > 3 && gSettings.onlyConvex())
-            mPolygon = convexHull(mPolygon);
-    }
-    // change color
-    if (willMutate(gSettings.colorMutationProbability())) {
-        const int r = RAND::dInt(mColor.red(), gSettings.dR(), 0, 255);
-        const int g = RAND::dInt(mColor.green(), gSettings.dG(), 0, 255);
-        const int b = RAND::dInt(mColor.blue(), gSettings.dB(), 0, 255);
-        const int a = RAND::dInt(mColor.alpha(), gSettings.dA(), gSettings.minA(), gSettings.maxA());
-        mColor.setRgb(r, g, b, a);
-    }
+    p.setX(RAND::dReal(p.x(), dXY, 0.0, 1.0));
+    p.setY(RAND::dReal(p.y(), dXY, 0.0, 1.0));
 }
 
 
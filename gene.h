@@ -10,12 +10,15 @@
 #include <QPolygonF>
 #include <QTextStream>
 #include "helper.h"
+#include "breedersettings.h"
 
 
 class Gene
 {
 public:
     explicit Gene(bool randomize = false);
+    /// random gene within the limits of the given settings
+    explicit Gene(const BreederSettings::Snapshot& settings);
 
     explicit Gene(const QPolygonF& polygon, const QColor& color)
         : mColor(color)
@@ -31,8 +34,7 @@ public:
 
     inline const QColor& color(void) const { return mColor; }
     inline const QPolygonF& polygon(void) const { return mPolygon; }
-
-    void mutate(void);
+    inline QRectF boundingRect(void) const { return mPolygon.boundingRect(); }
 
     QVector<Gene> bisect(void) const;
     QVector<Gene> triangulize(void) const;
@@ -41,17 +43,14 @@ public:
     bool isAlive(void) const { return mPolygon.size() > 0 && mColor.isValid(); }
     bool isConvex(void) const { return isConvexPolygon(mPolygon); }
 
-    static inline void randomlyTranslatePoint(QPointF&);
+    static void randomlyTranslatePoint(QPointF&, qreal dXY);
 
 private:
     QPolygonF mPolygon;
     QColor mColor;
 
-    bool willMutate(int rate) const;
-
     void deepCopy(const QPolygonF&);
-
-    QPolygonF evaluateTriangle(int, int, int) const;
+    void randomize(const BreederSettings::Snapshot&);
 };
 
 
@@ -0,0 +1,198 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QVarLengthArray>
+#include <string.h>
+#include "genegrid.h"
+
+
+static const int BitsPerWord = 64;
+
+
+static inline int lowestBit(quint64 w)
+{
+    Q_ASSERT(w != 0);
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    int b = 0;
+    while ((w & 1) == 0) {
+        w >>= 1;
+        ++b;
+    }
+    return b;
+#endif
+}
+
+
+static inline int highestBit(quint64 w)
+{
+    Q_ASSERT(w != 0);
+#if defined(__GNUC__)
+    return BitsPerWord - 1 - __builtin_clzll(w);
+#else
+    int b = 0;
+    while (w >>= 1)
+        ++b;
+    return b;
+#endif
+}
+
+
+GeneGrid::GeneGrid(void)
+    : mWords(0)
+{
+    /* ... */
+}
+
+
+/// copy other into this grid, reusing the storage already held
+void GeneGrid::assign(const GeneGrid& other)
+{
+    mWords = other.mWords;
+    mBits.resize(other.mBits.size());
+    memcpy(mBits.data(), other.mBits.constData(), other.mBits.size() * sizeof(quint64));
+}
+
+
+void GeneGrid::clear(void)
+{
+    mBits.fill(0);
+}
+
+
+/// make sure the bit sets have room for the given number of genes
+void GeneGrid::reserve(int genes)
+{
+    const int words = (genes + BitsPerWord - 1) / BitsPerWord;
+    if (words <= mWords)
+        return;
+    // grow by half at a time so that appending genes does not re-layout the grid each time
+    const int newWords = qMax(words, mWords + mWords / 2);
+    QVector<quint64> bits(Size * Size * newWords, 0);
+    for (int c = 0; c < Size * Size; ++c)
+        memcpy(bits.data() + c * newWords, mBits.constData() + c * mWords, mWords * sizeof(quint64));
+    mBits = bits;
+    mWords = newWords;
+}
+
+
+inline int GeneGrid::column(qreal v)
+{
+    return qBound(0, int(v * Size), Size - 1);
+}
+
+
+QRect GeneGrid::cellRange(const QRectF& rect) const
+{
+    if (rect.isNull())
+        return QRect();
+    return QRect(QPoint(column(rect.left()), column(rect.top())), QPoint(column(rect.right()), column(rect.bottom())));
+}
+
+
+void GeneGrid::add(int index, const QRectF& bounds)
+{
+    const QRect& range = cellRange(bounds);
+    if (range.isEmpty())
+        return;
+    Q_ASSERT(index < mWords * BitsPerWord);
+    const int word = index / BitsPerWord;
+    const quint64 bit = Q_UINT64_C(1) << (index % BitsPerWord);
+    for (int y = range.top(); y <= range.bottom(); ++y)
+        for (int x = range.left(); x <= range.right(); ++x)
+            cell(x, y)[word] |= bit;
+}
+
+
+void GeneGrid::remove(int index, const QRectF& bounds)
+{
+    const QRect& range = cellRange(bounds);
+    if (range.isEmpty())
+        return;
+    const int word = index / BitsPerWord;
+    const quint64 bit = Q_UINT64_C(1) << (index % BitsPerWord);
+    for (int y = range.top(); y <= range.bottom(); ++y)
+        for (int x = range.left(); x <= range.right(); ++x)
+            cell(x, y)[word] &= ~bit;
+}
+
+
+void GeneGrid::update(int index, const QRectF& oldBounds, const QRectF& newBounds)
+{
+    // most mutations move a gene by much less than the width of a cell
+    if (cellRange(oldBounds) == cellRange(newBounds))
+        return;
+    remove(index, oldBounds);
+    add(index, newBounds);
+}
+
+
+/// shift the bits of genes index..genes-1 up by one
+void GeneGrid::insertAt(int index, int genes)
+{
+    reserve(genes + 1);
+    const int word = index / BitsPerWord;
+    const quint64 low = (Q_UINT64_C(1) << (index % BitsPerWord)) - 1;
+    for (quint64* w = mBits.data(); w != mBits.data() + mBits.size(); w += mWords) {
+        for (int i = mWords - 1; i > word; --i)
+            w[i] = (w[i] << 1) | (w[i - 1] >> (BitsPerWord - 1));
+        w[word] = (w[word] & low) | ((w[word] & ~low) << 1);
+    }
+}
+
+
+/// shift the bits of the genes behind index down by one
+void GeneGrid::removeAt(int index)
+{
+    const int word = index / BitsPerWord;
+    if (word >= mWords)
+        return;
+    const quint64 low = (Q_UINT64_C(1) << (index % BitsPerWord)) - 1;
+    for (quint64* w = mBits.data(); w != mBits.data() + mBits.size(); w += mWords) {
+        w[word] = (w[word] & low) | ((w[word] >> 1) & ~low);
+        for (int i = word + 1; i < mWords; ++i) {
+            w[i - 1] |= w[i] << (BitsPerWord - 1);
+            w[i] >>= 1;
+        }
+    }
+}
+
+
+void GeneGrid::genesIn(const QRect& cells, QVector<int>& result) const
+{
+    result.resize(0);
+    if (cells.isEmpty() || mWords == 0)
+        return;
+    QVarLengthArray<quint64, 32> genes(mWords);
+    memset(genes.data(), 0, mWords * sizeof(quint64));
+    for (int y = cells.top(); y <= cells.bottom(); ++y) {
+        for (int x = cells.left(); x <= cells.right(); ++x) {
+            const quint64* w = cell(x, y);
+            for (int i = 0; i < mWords; ++i)
+                genes[i] |= w[i];
+        }
+    }
+    for (int i = 0; i < mWords; ++i) {
+        for (quint64 w = genes[i]; w != 0; w &= w - 1)
+            result.append(i * BitsPerWord + lowestBit(w));
+    }
+}
+
+
+int GeneGrid::geneAt(const QPointF& p, int before) const
+{
+    const quint64* w = cell(column(p.x()), column(p.y()));
+    int i = qMin(before, mWords * BitsPerWord);
+    while (i > 0) {
+        // bits of the genes below gene i in the word holding gene i-1
+        const int word = (i - 1) / BitsPerWord;
+        const int n = i - word * BitsPerWord;
+        const quint64 mask = (n == BitsPerWord)? ~Q_UINT64_C(0) : (Q_UINT64_C(1) << n) - 1;
+        const quint64 bits = w[word] & mask;
+        if (bits != 0)
+            return word * BitsPerWord + highestBit(bits);
+        i = word * BitsPerWord;
+    }
+    return -1;
+}
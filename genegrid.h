@@ -0,0 +1,61 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __GENEGRID_H_
+#define __GENEGRID_H_
+
+#include <QtGlobal>
+#include <QVector>
+#include <QRectF>
+#include <QRect>
+#include <QPointF>
+
+
+/// Uniform grid over the unit square telling which genes may overlap a
+/// point or rectangle. Each cell holds a bit set with one bit per gene
+/// whose bounding rect touches the cell, so the genes of an area come out
+/// in stacking order without duplicates by or-ing the cells it covers.
+/// All bit sets live in one flat array, which makes copying a grid as
+/// cheap as copying the other arrays of a DNA. The grid is kept up to date
+/// by DNA whenever a gene's bounding rect or index changes.
+class GeneGrid
+{
+public:
+    GeneGrid(void);
+    void assign(const GeneGrid& other);
+    void clear(void);
+
+    /// register gene index with the cells touched by bounds
+    void add(int index, const QRectF& bounds);
+    /// unregister gene index from the cells touched by bounds
+    void remove(int index, const QRectF& bounds);
+    /// move gene index from the cells touched by oldBounds to the ones touched by newBounds
+    void update(int index, const QRectF& oldBounds, const QRectF& newBounds);
+    /// make room for a gene in front of gene index in a grid of the given number of genes
+    void insertAt(int index, int genes);
+    /// close the gap left by gene index, which must already be unregistered
+    void removeAt(int index);
+
+    /// cells touched by rect (in normalized coordinates), empty if rect is null
+    QRect cellRange(const QRectF& rect) const;
+    /// genes registered with any of the given cells, bottom to top
+    void genesIn(const QRect& cells, QVector<int>& result) const;
+    /// topmost gene below gene before that is registered with the cell containing p, -1 if there is none
+    int geneAt(const QPointF& p, int before) const;
+
+    /// number of columns and rows
+    static const int Size = 16;
+
+private:
+    /// bit sets of all cells, mWords words per cell
+    QVector<quint64> mBits;
+    int mWords;
+
+    static int column(qreal v);
+    inline quint64* cell(int x, int y) { return mBits.data() + (x + y * Size) * mWords; }
+    inline const quint64* cell(int x, int y) const { return mBits.constData() + (x + y * Size) * mWords; }
+    void reserve(int genes);
+};
+
+
+#endif // __GENEGRID_H_
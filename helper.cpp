@@ -4,6 +4,8 @@
 #include <QObject>
 #include <QFileInfo>
 #include <QFile>
+#include <qmath.h>
+#include <algorithm>
 #include "helper.h"
 
 
@@ -22,6 +24,19 @@ QString secondsToTime(int seconds)
 }
 
 
+/// pixel area of a rect given in normalized coordinates, widened by one pixel for antialiased edges
+QRect pixelRect(const QRectF& normalized, const QSize& size)
+{
+    if (normalized.isNull())
+        return QRect();
+    const int x0 = qFloor(normalized.left() * size.width()) - 1;
+    const int y0 = qFloor(normalized.top() * size.height()) - 1;
+    const int x1 = qCeil(normalized.right() * size.width()) + 1;
+    const int y1 = qCeil(normalized.bottom() * size.height()) + 1;
+    return QRect(x0, y0, x1 - x0, y1 - y0) & QRect(0, 0, size.width(), size.height());
+}
+
+
 void avoidDuplicateFilename(QString& filename)
 {
     QFileInfo info(filename);
@@ -84,3 +99,85 @@ QPolygonF convexHull(QPolygonF P)
 }
 
 
+/// true if the polygon turns left at every vertex and winds around only once, as the output of convexHull() does
+bool isStrictlyConvex(const QPointF* points, int n)
+{
+    if (n < 3)
+        return false;
+    int signChanges = 0;
+    int lastSign = 0;
+    for (int i = 0; i < n; ++i) {
+        const QPointF& a = points[i];
+        const QPointF& b = points[(i+1) % n];
+        if (cross(a, b, points[(i+2) % n]) <= 0)
+            return false;
+        // a polygon winding around more than once changes its horizontal direction more than twice
+        const int sign = (b.x() > a.x())? 1 : (b.x() < a.x())? -1 : 0;
+        if (sign != 0) {
+            if (lastSign != 0 && sign != lastSign)
+                ++signChanges;
+            lastSign = sign;
+        }
+    }
+    return signChanges <= 2;
+}
+
+
+/// Insert p into the strictly convex polygon hull with n vertices. Only
+/// the chain of edges visible from p is replaced, so the result is the
+/// convex hull of hull and p. Returns the new number of vertices; hull
+/// must have room for n+1 of them.
+static int addToConvexHull(QPointF* hull, int n, const QPointF& p)
+{
+    int first = -1;
+    for (int i = 0; i < n; ++i) {
+        if (cross(hull[i], hull[(i+1) % n], p) < 0) {
+            first = i;
+            break;
+        }
+    }
+    if (first < 0) // inside or on the boundary
+        return n;
+    // extend the visible chain, taking collinear edges along so that no vertex ends up on a straight line
+    int a = first;
+    int b = (first+1) % n;
+    int visible = 1;
+    while (visible < n-1 && cross(hull[(a+n-1) % n], hull[a], p) <= 0) {
+        a = (a+n-1) % n;
+        ++visible;
+    }
+    while (visible < n-1 && cross(hull[b], hull[(b+1) % n], p) <= 0) {
+        b = (b+1) % n;
+        ++visible;
+    }
+    // keep b .. a, drop the vertices in between and put p behind a
+    std::rotate(hull, hull + b, hull + n);
+    const int m = (a-b+n) % n + 1;
+    hull[m] = p;
+    return m + 1;
+}
+
+
+/// Add count points to the convex polygon hull with n vertices and return
+/// the number of vertices of the resulting hull, which must have room for
+/// n+count of them. Falls back to convexHull() if hull is not strictly
+/// convex, e.g. because the settings have just been switched to convex
+/// polygons.
+int addToConvexHull(QPointF* hull, int n, const QPointF* points, int count)
+{
+    if (count == 0)
+        return n;
+    if (!isStrictlyConvex(hull, n)) {
+        QPolygonF polygon(n + count);
+        std::copy(hull, hull + n, polygon.begin());
+        std::copy(points, points + count, polygon.begin() + n);
+        const QPolygonF& h = convexHull(polygon);
+        std::copy(h.constBegin(), h.constEnd(), hull);
+        return h.size();
+    }
+    for (int i = 0; i < count; ++i)
+        n = addToConvexHull(hull, n, points[i]);
+    return n;
+}
+
+
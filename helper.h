@@ -7,11 +7,17 @@
 #include <QString>
 #include <QPointF>
 #include <QPolygonF>
+#include <QRect>
+#include <QRectF>
+#include <QSize>
 
 extern QString secondsToTime(int);
 extern void avoidDuplicateFilename(QString& filename);
 extern bool isConvexPolygon(const QPolygonF&);
 extern QPolygonF convexHull(QPolygonF);
+extern bool isStrictlyConvex(const QPointF* points, int n);
+extern int addToConvexHull(QPointF* hull, int n, const QPointF* points, int count);
+extern QRect pixelRect(const QRectF& normalized, const QSize& size);
 
 template <typename T>
 inline T square(T x) { return x*x; }
@@ -25,6 +31,11 @@ enum StartDistribution {
     TiledTrianglesWithColorHintDistribution = 5
 };
 
+enum Renderer {
+    QPainterRenderer = 0,
+    ScanlineRenderer = 1
+};
+
 inline bool pointLessThan(const QPointF& a, const QPointF& b)
 {
     return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
@@ -6,8 +6,14 @@
 
 #include <QImage>
 #include <QPainter>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
 #include <QtCore/QDebug>
 #include "helper.h"
+#include "rasterizer.h"
+#include "fitness.h"
+#include "compositecache.h"
 #include "dna.h"
 #include "breedersettings.h"
 
@@ -16,6 +22,12 @@ class Individual {
 public:
     explicit Individual(void)
         : mFitness(std::numeric_limits<quint64>::max())
+        , mParentFitness(std::numeric_limits<quint64>::max())
+        , mCache(NULL)
+        , mApproximate(false)
+        , mSkippedPixels(0)
+        , mRevision(0)
+        , mSettings(gSettings.snapshot())
     { /* ... */ }
 
     explicit Individual(DNA dna, const QImage& original)
@@ -23,62 +35,278 @@ public:
         , mOriginal(original)
         , mFitness(std::numeric_limits<quint64>::max())
         , mGenerated(original.size(), original.format())
+        , mParentFitness(std::numeric_limits<quint64>::max())
+        , mCache(NULL)
+        , mApproximate(false)
+        , mSkippedPixels(0)
+        , mRevision(0)
+        , mSettings(gSettings.snapshot())
     { /* ... */ }
 
+    /// offspring of a parent whose rendering and fitness are known,
+    /// so that only the area touched by a mutation must be redrawn;
+    /// cache (if valid) must hold the composites of the parent's DNA
+    explicit Individual(DNA dna, const QImage& original, const QImage& parent, quint64 parentFitness, const CompositeCache* cache = NULL)
+        : mDNA(dna)
+        , mOriginal(original)
+        , mFitness(std::numeric_limits<quint64>::max())
+        , mGenerated(parent)
+        , mParentFitness(parentFitness)
+        , mCache(cache)
+        , mApproximate(false)
+        , mSkippedPixels(0)
+        , mRevision(0)
+        , mSettings(gSettings.snapshot())
+    { /* ... */ }
+
+    /// Turn the individual into a fresh offspring of the given parent. The
+    /// DNA, the render band and the rasterizer keep their storage, so
+    /// individuals reused across generations do not allocate here.
+    ///
+    /// revision identifies the state of the parent's DNA (0 if unknown),
+    /// patch (if not NULL) turns revision-1 into revision. Instead of
+    /// copying the parent, the last mutation is undone and the parent's
+    /// patch applied if possible, so that the cost scales with the size
+    /// of the mutations rather than the size of the DNA. The offspring is
+    /// mutated and rendered according to settings.
+    void reset(const BreederSettings::Snapshot& settings, const DNA& dna, quint64 revision, const DNAPatch* patch, const QImage& original, const QImage& parent, quint64 parentFitness, const CompositeCache* cache = NULL) {
+        if (revision != 0 && revision == mRevision) {
+            mDNA.revert(mPatch);
+        }
+        else if (patch != NULL && mRevision != 0 && revision == mRevision + 1) {
+            mDNA.revert(mPatch);
+            mDNA.apply(*patch);
+        }
+        else {
+            mDNA.assign(dna);
+        }
+        mPatch.clear();
+        mRevision = revision;
+        mOriginal = original;
+        mFitness = std::numeric_limits<quint64>::max();
+        mGenerated = parent;
+        mParentFitness = parentFitness;
+        mPendingRect = QRect();
+        mCache = cache;
+        mApproximate = false;
+        mSkippedPixels = 0;
+        mSettings = settings;
+    }
+
+    /// call updateGenerated() first if the individual has been evolved
     inline const QImage& generated(void) const { return mGenerated; }
     inline const DNA& dna(void) const { return mDNA; }
+    /// changes made to the parent's DNA by the last call to evolve()
+    inline const DNAPatch& patch(void) const { return mPatch; }
     inline quint64 fitness(void) const { return mFitness; }
+    /// pixels the last call to evolve() may have changed
+    inline QRect changedRect(void) const { return dirtyPixelRect(); }
+    /// true if the fitness has been estimated from the composite cache
+    inline bool isApproximate(void) const { return mApproximate; }
     inline void operator()(Individual& individual) { individual.evolve(); }
 
     inline void draw(void) {
+        draw(mGenerated.rect());
+    }
+
+    /// redraw the given area (in pixels) of the generated image
+    void draw(const QRect& clipRect) {
         if (mGenerated.isNull())
             return;
+        const bool partial = (clipRect != mGenerated.rect());
+        const QRectF& area = normalized(clipRect);
+        if (mSettings.renderer == ScanlineRenderer) {
+            Rasterizer r(&mGenerated);
+            r.setClipRect(clipRect);
+            r.fill(mSettings.backgroundColor);
+            if (partial) {
+                mDNA.genesIn(area, mGenes);
+                for (QVector<int>::const_iterator i = mGenes.constBegin(); i != mGenes.constEnd(); ++i)
+                    r.blendCoverage(mDNA.coverage(*i, mGenerated.size()).constData(), mDNA.coverageRect(*i), mDNA.color(*i));
+                return;
+            }
+            for (int i = 0; i < mDNA.size(); ++i)
+                r.blendCoverage(mDNA.coverage(i, mGenerated.size()).constData(), mDNA.coverageRect(i), mDNA.color(i));
+            return;
+        }
         QPainter p(&mGenerated);
+        p.setClipRect(clipRect);
         p.setPen(Qt::transparent);
-        p.setBrush(QBrush(QColor(gSettings.backgroundColor())));
+        p.setBrush(QBrush(QColor(mSettings.backgroundColor)));
         p.drawRect(0, 0, mGenerated.width(), mGenerated.height());
         p.setRenderHint(QPainter::Antialiasing);
         p.scale(mGenerated.width(), mGenerated.height());
-        for (DNAType::const_iterator gene = mDNA.constBegin(); gene != mDNA.constEnd(); ++gene) {
-            p.setBrush(gene->color());
-            p.drawPolygon(gene->polygon());
+        for (int i = 0; i < mDNA.size(); ++i) {
+            if (partial && !mDNA.boundingRect(i).intersects(area))
+                continue;
+            p.setBrush(QColor::fromRgba(mDNA.color(i)));
+#ifdef QUANTIZED_COORDINATES
+            p.drawPolygon(mDNA.polygon(i));
+#else
+            p.drawPolygon(mDNA.vertices(i), mDNA.vertexCount(i));
+#endif
         }
     }
 
+    /// bring the generated image up to date with the DNA after evolve()
+    inline void updateGenerated(void) {
+        if (mPendingRect.isEmpty())
+            return;
+        draw(mPendingRect);
+        mPendingRect = QRect();
+    }
+
     inline quint64 calcFitness(void) {
         draw();
-        mFitness = 0;
-        const QRgb* o = reinterpret_cast<const QRgb*>(mOriginal.constBits());
-        const QRgb* const oEnd = o + mOriginal.width() * mOriginal.height();
-        const QRgb* g = reinterpret_cast<const QRgb*>(mGenerated.constBits());
-        while (o < oEnd)
-            mFitness += rgbDelta(*o++, *g++);
+        mFitness = error(mGenerated.rect());
         return mFitness;
     }
 
+    /// Sum of color deltas between generated and original image inside the
+    /// given area (in pixels). Gives up as soon as the sum reaches limit.
+    quint64 error(const QRect& rect, quint64 limit = std::numeric_limits<quint64>::max()) {
+        quint64 sum = 0;
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            const QRgb* o = reinterpret_cast<const QRgb*>(mOriginal.constScanLine(y)) + rect.left();
+            const QRgb* g = reinterpret_cast<const QRgb*>(mGenerated.constScanLine(y)) + rect.left();
+            sum += rgbDeltaSum(o, g, rect.width());
+            if (sum >= limit) {
+                mSkippedPixels += quint64(rect.bottom() - y) * rect.width();
+                break;
+            }
+        }
+        return sum;
+    }
+
+    /// Render the given area (in pixels) in bands small enough to stay in the
+    /// cache and compare each band with the original right away. The
+    /// generated image is left untouched. Gives up after the band in which
+    /// the sum reaches limit.
+    quint64 renderError(const QRect& rect, quint64 limit = std::numeric_limits<quint64>::max()) {
+        if (mSettings.renderer != ScanlineRenderer) {
+            draw(rect);
+            return error(rect, limit);
+        }
+        const int bandHeight = qBound(1, BandBytes / int(sizeof(QRgb) * mOriginal.width()), mOriginal.height());
+        if (mBand.width() != mOriginal.width() || mBand.height() != bandHeight)
+            mBand = QImage(mOriginal.width(), bandHeight, QImage::Format_ARGB32);
+        quint64 sum = 0;
+        Rasterizer& r = mRasterizer;
+        for (int top = rect.top(); top <= rect.bottom(); top += bandHeight) {
+            const QRect band(rect.left(), top, rect.width(), qMin(bandHeight, rect.bottom() + 1 - top));
+            const QRectF& area = normalized(band);
+            r.setBand(&mBand, mOriginal.size(), top);
+            r.setClipRect(band);
+            r.fill(mSettings.backgroundColor);
+            mDNA.genesIn(area, mGenes);
+            for (QVector<int>::const_iterator i = mGenes.constBegin(); i != mGenes.constEnd(); ++i)
+                r.blendCoverage(mDNA.coverage(*i, mOriginal.size()).constData(), mDNA.coverageRect(*i), mDNA.color(*i));
+            for (int y = band.top(); y <= band.bottom(); ++y) {
+                const QRgb* o = reinterpret_cast<const QRgb*>(mOriginal.constScanLine(y)) + band.left();
+                const QRgb* g = reinterpret_cast<const QRgb*>(mBand.constScanLine(y - top)) + band.left();
+                sum += rgbDeltaSum(o, g, band.width());
+            }
+            if (sum >= limit) {
+                mSkippedPixels += quint64(rect.bottom() - band.bottom()) * rect.width();
+                break;
+            }
+        }
+        return sum;
+    }
+
     quint64 maximumFitnessDelta(void) const {
         quint64 maxDelta = 0;
-        const QRgb* o = reinterpret_cast<const QRgb*>(mOriginal.constBits());
-        const QRgb* const oEnd = o + mOriginal.width() * mOriginal.height();
-        while (o < oEnd)
-            maxDelta += rgbDelta(*o++, qRgba(255, 255, 255, 255));
+        const QVector<QRgb> white(mOriginal.width(), qRgba(255, 255, 255, 255));
+        for (int y = 0; y < mOriginal.height(); ++y)
+            maxDelta += rgbDeltaSum(reinterpret_cast<const QRgb*>(mOriginal.constScanLine(y)), white.constData(), white.size());
         return maxDelta;
     }
 
     inline void evolve(void) {
-        mDNA.mutate();
-        calcFitness();
+        mDNA.mutate(mSettings, &mPatch);
+        if (mParentFitness == std::numeric_limits<quint64>::max() || mGenerated.size() != mOriginal.size()) {
+            mGenerated = QImage(mOriginal.size(), mOriginal.format());
+            mPendingRect = mGenerated.rect();
+            mFitness = renderError(mPendingRect);
+            if (mSettings.renderer != ScanlineRenderer)
+                mPendingRect = QRect(); // renderError() has already drawn into mGenerated
+            return;
+        }
+        // only render the area touched by the mutation and patch the parent's fitness
+        mPendingRect = dirtyPixelRect();
+        if (mPendingRect.isEmpty()) {
+            mFitness = mParentFitness;
+            return;
+        }
+        const int k = mDNA.mutatedGene();
+        if (k >= 0 && mCache != NULL && mCache->isValid()) {
+            // estimate from three layers instead of rendering all genes
+            const qint64 delta = mCache->errorDelta(mOriginal, mPendingRect, k, mDNA, mScratch);
+            mFitness = quint64(qMax(Q_INT64_C(0), qint64(mParentFitness) + delta));
+            mApproximate = true;
+            return;
+        }
+        evaluateAgainstParent();
     }
 
+    /// replace an estimated fitness by the exact one
+    inline void evaluate(void) {
+        if (!mApproximate)
+            return;
+        mApproximate = false;
+        evaluateAgainstParent();
+    }
+
+    /// pixels left unevaluated because the candidate could no longer beat its parent
+    inline quint64 skippedPixels(void) const { return mSkippedPixels; }
+
 private:
     DNA mDNA;
     QImage mOriginal;
     quint64 mFitness;
     QImage mGenerated;
+    quint64 mParentFitness;
+    QRect mPendingRect;
+    QImage mBand;
+    Rasterizer mRasterizer;
+    const CompositeCache* mCache;
+    CompositeCache::Scratch mScratch;
+    /// genes overlapping the area being rendered
+    QVector<int> mGenes;
+    bool mApproximate;
+    quint64 mSkippedPixels;
+    DNAPatch mPatch;
+    /// revision of the parent's DNA as passed to reset()
+    quint64 mRevision;
+    /// settings of the generation the individual belongs to
+    BreederSettings::Snapshot mSettings;
+
+    /// size of a render band, chosen to fit into the L2 cache together with the original's rows
+    static const int BandBytes = 64 * 1024;
 
 private: // methods
-    static inline unsigned int rgbDelta(QRgb c1, QRgb c2) {
-        return square(qRed(c1) - qRed(c2)) + square(qGreen(c1) - qGreen(c2)) + square(qBlue(c1) - qBlue(c2));
+    /// Patch the parent's fitness with the error of the pending area. As
+    /// only offsprings fitter than their parent get selected, evaluation
+    /// stops once the new error reaches the old one; the fitness is then
+    /// set to the worst possible value.
+    void evaluateAgainstParent(void) {
+        const quint64 oldError = error(mPendingRect);
+        const quint64 newError = renderError(mPendingRect, oldError);
+        mFitness = (newError < oldError)
+                ? mParentFitness - oldError + newError
+                : std::numeric_limits<quint64>::max();
+        if (mSettings.renderer != ScanlineRenderer)
+            mPendingRect = QRect(); // renderError() has already drawn into mGenerated
+    }
+
+    inline QRectF normalized(const QRect& rect) const {
+        return QRectF(qreal(rect.x()) / mGenerated.width(), qreal(rect.y()) / mGenerated.height(),
+                      qreal(rect.width()) / mGenerated.width(), qreal(rect.height()) / mGenerated.height());
+    }
+
+    /// dirty rect of the last mutation in pixels, including a margin for antialiased edges
+    inline QRect dirtyPixelRect(void) const {
+        return pixelRect(mDNA.dirtyRect(), mGenerated.size());
     }
 };
 
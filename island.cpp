@@ -0,0 +1,194 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QDataStream>
+#include <QSharedPointer>
+#include <QtCore/QDebug>
+#include <limits>
+#include "island.h"
+
+
+static const QDataStream::Version StreamVersion = QDataStream::Qt_4_6;
+
+
+Island::Island(Breeder* breeder, QObject* parent)
+    : QObject(parent)
+    , mBreeder(breeder)
+    , mServer(NULL)
+    , mInterval(100)
+    , mLastMigration(0)
+    , mMigrantFitness(std::numeric_limits<quint64>::max())
+    , mEmigrants(0)
+    , mImmigrants(0)
+    , mSocketError(QLocalSocket::UnknownSocketError)
+{
+    Q_ASSERT(breeder != NULL);
+    QObject::connect(mBreeder, SIGNAL(proceeded(unsigned long)), SLOT(proceeded(unsigned long)));
+}
+
+
+Island::~Island()
+{
+    leave();
+}
+
+
+void Island::setInterval(unsigned long generations)
+{
+    Q_ASSERT(generations > 0);
+    mInterval = generations;
+}
+
+
+bool Island::join(const QString& name)
+{
+    leave();
+    if (connectTo(name))
+        return true;
+    // nobody there yet, so this island becomes the hub
+    mServer = new QLocalServer(this);
+    if (!mServer->listen(name)) {
+        // another island may have become the hub in the meantime
+        delete mServer;
+        mServer = NULL;
+        if (connectTo(name))
+            return true;
+        // A hub that does not answer in time may merely be busy. Only a
+        // socket nobody listens on has been left behind by a hub that
+        // crashed, and may be removed.
+        if (mSocketError != QLocalSocket::ServerNotFoundError && mSocketError != QLocalSocket::ConnectionRefusedError)
+            return false;
+        QLocalServer::removeServer(name);
+        mServer = new QLocalServer(this);
+        if (!mServer->listen(name)) {
+            mErrorString = mServer->errorString();
+            delete mServer;
+            mServer = NULL;
+            return false;
+        }
+    }
+    QObject::connect(mServer, SIGNAL(newConnection()), SLOT(acceptConnections()));
+    return true;
+}
+
+
+bool Island::connectTo(const QString& name)
+{
+    QLocalSocket* socket = new QLocalSocket(this);
+    socket->connectToServer(name);
+    if (!socket->waitForConnected(ConnectTimeout)) {
+        mSocketError = socket->error();
+        mErrorString = socket->errorString();
+        delete socket;
+        return false;
+    }
+    addSocket(socket);
+    return true;
+}
+
+
+void Island::leave(void)
+{
+    foreach (QLocalSocket* socket, mSockets) {
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+    }
+    mSockets.clear();
+    delete mServer;
+    mServer = NULL;
+}
+
+
+void Island::addSocket(QLocalSocket* socket)
+{
+    mSockets.append(socket);
+    QObject::connect(socket, SIGNAL(readyRead()), SLOT(receive()));
+    QObject::connect(socket, SIGNAL(disconnected()), SLOT(disconnected()));
+}
+
+
+void Island::acceptConnections(void)
+{
+    while (mServer->hasPendingConnections())
+        addSocket(mServer->nextPendingConnection());
+}
+
+
+/// islands that lose their hub go on breeding by themselves
+void Island::disconnected(void)
+{
+    QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+    Q_ASSERT(socket != NULL);
+    mSockets.removeAll(socket);
+    socket->deleteLater();
+}
+
+
+void Island::send(const QByteArray& message, const QLocalSocket* except)
+{
+    foreach (QLocalSocket* socket, mSockets) {
+        if (socket != except)
+            socket->write(message);
+    }
+}
+
+
+void Island::proceeded(unsigned long generation)
+{
+    if (mSockets.isEmpty() || generation - mLastMigration < mInterval)
+        return;
+    mLastMigration = generation;
+    // the published state may be serialized in this thread while the breeder goes on
+    const QSharedPointer<const Breeder::State>& state = mBreeder->state();
+    if (state->fitness >= mMigrantFitness)
+        return;
+    mMigrantFitness = state->fitness;
+    QByteArray message;
+    QDataStream out(&message, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    out << quint32(0) << quint8(Migrant) << quint64(state->fitness) << state->dna;
+    out.device()->seek(0);
+    out << quint32(message.size() - sizeof(quint32));
+    send(message);
+    ++mEmigrants;
+}
+
+
+void Island::receive(void)
+{
+    QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+    Q_ASSERT(socket != NULL);
+    while (socket->bytesAvailable() >= qint64(sizeof(quint32))) {
+        quint32 size = 0;
+        QDataStream(socket->peek(sizeof(quint32))) >> size;
+        if (size > MaxMessageSize) {
+            qWarning() << "Island::receive() message too big:" << size;
+            socket->abort();
+            return;
+        }
+        if (socket->bytesAvailable() < qint64(sizeof(quint32) + size))
+            return;
+        const QByteArray& message = socket->read(sizeof(quint32) + size);
+        // the hub passes migrants on to everyone but their sender
+        if (isHub())
+            send(message, socket);
+        QDataStream in(message);
+        in.setVersion(StreamVersion);
+        quint32 length = 0;
+        quint8 type = 0;
+        quint64 fitness = 0;
+        DNA dna;
+        in >> length >> type;
+        if (type != Migrant)
+            continue;
+        in >> fitness >> dna;
+        if (in.status() != QDataStream::Ok)
+            continue;
+        ++mImmigrants;
+        mMigrantFitness = qMin(mMigrantFitness, fitness);
+        // the breeder checks the fitness itself before adopting the DNA
+        if (fitness < mBreeder->state()->fitness)
+            mBreeder->immigrate(dna);
+    }
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __ISLAND_H_
+#define __ISLAND_H_
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "breeder.h"
+
+
+/// One of several breeder processes on the same host, each evolving a
+/// DNA of its own for the same image. Every interval() generations an
+/// island sends its DNA to the others if it has become fitter than the
+/// last one it has sent or received; they adopt it if it beats their own.
+///
+/// The first island to join under a name listens on the local socket of
+/// that name and passes the migrants on between the islands connecting
+/// to it. A message is a 32 bit length followed by the QDataStream of the
+/// message type, the sender's fitness and the DNA.
+class Island : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Island(Breeder* breeder, QObject* parent = NULL);
+    ~Island();
+
+    /// connect to the islands of the given name, becoming their hub if there is none yet
+    bool join(const QString& name);
+    void leave(void);
+    inline bool isHub(void) const { return mServer != NULL; }
+    inline const QString& errorString(void) const { return mErrorString; }
+
+    inline unsigned long interval(void) const { return mInterval; }
+    void setInterval(unsigned long generations);
+
+    /// number of direct connections: to the other islands for the hub, to the hub for the others
+    inline int neighbours(void) const { return mSockets.size(); }
+    inline unsigned long emigrants(void) const { return mEmigrants; }
+    inline unsigned long immigrants(void) const { return mImmigrants; }
+
+    static const int ConnectTimeout = 1000;
+    static const quint32 MaxMessageSize = 64 * 1024 * 1024;
+
+private slots:
+    void proceeded(unsigned long generation);
+    void acceptConnections(void);
+    void receive(void);
+    void disconnected(void);
+
+private:
+    enum MessageType { Migrant = 1 };
+
+    Breeder* mBreeder;
+    QLocalServer* mServer;
+    /// the hub's connections to the other islands, or the connection to the hub
+    QList<QLocalSocket*> mSockets;
+    unsigned long mInterval;
+    unsigned long mLastMigration;
+    /// fitness of the fittest DNA sent or received so far
+    quint64 mMigrantFitness;
+    unsigned long mEmigrants;
+    unsigned long mImmigrants;
+    QString mErrorString;
+    /// why the last connection attempt failed
+    QLocalSocket::LocalSocketError mSocketError;
+
+private: // methods
+    bool connectTo(const QString& name);
+    void addSocket(QLocalSocket* socket);
+    void send(const QByteArray& message, const QLocalSocket* except = NULL);
+};
+
+
+#endif // __ISLAND_H_
@@ -349,7 +349,8 @@ void MainWindow::evolved(const QImage& image, const DNA& dna, quint64 fitness, u
 void MainWindow::evolved(void)
 {
     proceeded(mBreeder.generation());
-    evolved(mBreeder.image(), mBreeder.constDNA(), mBreeder.currentFitness(), mBreeder.selected(), mBreeder.selectedGeneration());
+    const QSharedPointer<const Breeder::State>& state = mBreeder.state();
+    evolved(state->image, state->dna, state->fitness, state->selected, state->selectedGeneration);
 }
 
 
@@ -365,8 +366,10 @@ bool MainWindow::autoSaveDNA(void)
 {
     QString dnaFilename = mOptionsForm->makeDNAFilename(mImageWidget->imageFileName(), mRecentEvolvedGeneration, mRecentEvolvedSelection);
     gSettings.setCurrentDNAFile(dnaFilename);
-    DNA dna = mBreeder.dna(); // gives a clone
-    return dna.save(dnaFilename, mRecentEvolvedGeneration, mRecentEvolvedSelection, mBreeder.currentFitness(), totalSeconds());
+    // the published state may be saved while the breeder carries on
+    const QSharedPointer<const Breeder::State>& state = mBreeder.state();
+    DNA dna = state->dna;
+    return dna.save(dnaFilename, mRecentEvolvedGeneration, mRecentEvolvedSelection, state->fitness, totalSeconds());
 }
 
 
@@ -485,6 +488,8 @@ void MainWindow::stopBreeding(void)
     mAutoSaveTimer.stop();
     mBreeder.stop();
     mBreeder.addTotalSeconds(QDateTime::currentDateTime().toTime_t() - mStartTime.toTime_t());
+    doLog(QString("early abort skipped %1 pixels per candidate on average").arg(mBreeder.averageSkippedPixels(), 0, 'f', 1));
+    doLog(QString("%1 selections coalesced into later updates").arg(mBreeder.coalescedUpdates()));
     doLog("STOP.");
     if (mLog.isOpen())
         mLog.close();
@@ -623,7 +628,8 @@ void MainWindow::saveDNA(void)
 
 void MainWindow::imageDropped(const QImage&)
 {
-    evolved(mBreeder.image(), mBreeder.constDNA(), mBreeder.currentFitness(), mBreeder.selected(), mBreeder.generation());
+    const QSharedPointer<const Breeder::State>& state = mBreeder.state();
+    evolved(state->image, state->dna, state->fitness, state->selected, mBreeder.generation());
 }
 
 
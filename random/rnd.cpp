@@ -2,16 +2,91 @@
 // Alle Rechte vorbehalten.
 
 #include "rnd.h"
+#include "mersenne_twister.h"
+#include "xoshiro256starstar.h"
 
 #include <QDateTime>
-
-MT::MersenneTwister rng;
+#include <QCoreApplication>
+#include <QThreadStorage>
+#include <QAtomicInt>
 
 namespace RAND {
 
+RAND_THREAD_LOCAL randomtools::UIntRandomNumberGenerator* currentEngine = NULL;
+
+/// owns the engines and deletes them when their thread finishes
+static QThreadStorage<randomtools::UIntRandomNumberGenerator*> engines;
+static unsigned int master = 9U;
+static Engine type = XoshiroEngine;
+/// threads that did not pick a stream get one from this range
+static const unsigned int FirstUnnamedStream = 0x80000000U;
+static QAtomicInt unnamedStreams(0);
+
+
+/// mix master seed and stream number so that neighbouring streams get unrelated seeds
+static unsigned int streamSeed(unsigned int stream)
+{
+    unsigned int x = master ^ (stream * 0x9e3779b9U);
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35U;
+    x ^= x >> 16;
+    return x;
+}
+
+
+/// seed from the clock and the process id, so that processes started at the same time breed differently
 void initialize(void)
 {
-    rng.seed(QDateTime::currentDateTime().toTime_t());
+    const quint64 ms = quint64(QDateTime::currentMSecsSinceEpoch());
+    seed(static_cast<unsigned int>(ms ^ (ms >> 32)) ^ (static_cast<unsigned int>(QCoreApplication::applicationPid()) * 0x85ebca6bU));
+}
+
+
+/// set the master seed and reseed the calling thread as stream 0
+void seed(unsigned int s)
+{
+    master = s;
+    seedThread(0);
+}
+
+
+unsigned int masterSeed(void)
+{
+    return master;
+}
+
+
+/// give the calling thread a fresh engine seeded for the given stream
+void seedThread(unsigned int stream)
+{
+    randomtools::UIntRandomNumberGenerator* e = (type == MersenneTwisterEngine)
+            ? static_cast<randomtools::UIntRandomNumberGenerator*>(new MT::MersenneTwister)
+            : static_cast<randomtools::UIntRandomNumberGenerator*>(new Xoshiro::Xoshiro256StarStar);
+    e->seed(streamSeed(stream));
+    engines.setLocalData(e); // deletes the previous engine
+    currentEngine = e;
+}
+
+
+/// engine type used by subsequent calls to seedThread()
+void setEngine(Engine e)
+{
+    type = e;
+}
+
+
+Engine engineType(void)
+{
+    return type;
+}
+
+
+randomtools::UIntRandomNumberGenerator& createEngine(void)
+{
+    seedThread(FirstUnnamedStream + unnamedStreams.fetchAndAddRelaxed(1));
+    return *currentEngine;
 }
 
 }
@@ -5,27 +5,56 @@
 #define __RND_H_
 
 #include <QtCore>
-#include "mersenne_twister.h"
+#include <qmath.h>
+#include <cmath>
+#include <limits>
+#include "abstract_random_number_generator.h"
 
-
-extern MT::MersenneTwister rng;
+#if defined(_MSC_VER)
+#define RAND_THREAD_LOCAL __declspec(thread)
+#else
+#define RAND_THREAD_LOCAL __thread
+#endif
 
 
+/// Every thread draws from an engine of its own. Engines are seeded from
+/// a master seed and a stream number, so a thread seeded with the same
+/// master seed and stream always gets the same sequence.
 namespace RAND {
 
+enum Engine {
+    MersenneTwisterEngine,
+    XoshiroEngine
+};
+
 extern void initialize(void);
+extern void seed(unsigned int masterSeed);
+extern unsigned int masterSeed(void);
+extern void seedThread(unsigned int stream);
+extern void setEngine(Engine);
+extern Engine engineType(void);
+extern randomtools::UIntRandomNumberGenerator& createEngine(void);
+
+extern RAND_THREAD_LOCAL randomtools::UIntRandomNumberGenerator* currentEngine;
+
+
+/// engine of the calling thread
+inline randomtools::UIntRandomNumberGenerator& engine(void)
+{
+    return (currentEngine != NULL)? *currentEngine : createEngine();
+}
 
 
 inline unsigned int rnd(void)
 {
-    return rng.next();
+    return engine()();
 }
 
 
 inline unsigned int rnd(int a)
 {
     Q_ASSERT(a != 0);
-    return rng.next() % a;
+    return RAND::rnd() % a;
 }
 
 
@@ -36,9 +65,23 @@ inline int rnd(int a, int b)
 }
 
 
+/// Number of failures before the first success in a series of Bernoulli
+/// trials that succeed with probability 1/a each, i.e. the number of sites
+/// to skip until the next one for which rnd(a) == 0 would have come true.
+inline int geometric(int a)
+{
+    Q_ASSERT(a > 0);
+    if (a == 1)
+        return 0;
+    const double u = (RAND::rnd() + 1.0) / (engine().max() + 1.0);
+    const double g = std::floor(qLn(u) / qLn(1.0 - 1.0 / a));
+    return (g < std::numeric_limits<int>::max())? int(g) : std::numeric_limits<int>::max();
+}
+
+
 inline double rnd1(void)
 {
-    return (double)RAND::rnd() / rng.max();
+    return (double)RAND::rnd() / engine().max();
 }
 
 
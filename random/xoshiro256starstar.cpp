@@ -0,0 +1,36 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include "xoshiro256starstar.h"
+
+namespace Xoshiro {
+
+
+    /// expand the seed with splitmix64, which never yields an all-zero state
+    void Xoshiro256StarStar::seed(unsigned int _Seed)
+    {
+        unsigned long long x = _Seed;
+        for (int i = 0; i < 4; ++i) {
+            x += 0x9e3779b97f4a7c15ULL;
+            unsigned long long z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s[i] = z ^ (z >> 31);
+        }
+    }
+
+
+    unsigned int Xoshiro256StarStar::operator()()
+    {
+        const unsigned long long result = rotl(s[1] * 5, 7) * 9;
+        const unsigned long long t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return (unsigned int)(result >> 32);
+    }
+
+}
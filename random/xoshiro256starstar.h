@@ -0,0 +1,31 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __XOSHIRO256STARSTAR_H_
+#define __XOSHIRO256STARSTAR_H_
+
+#include "abstract_random_number_generator.h"
+
+namespace Xoshiro {
+
+    /// xoshiro256** by David Blackman and Sebastiano Vigna: 256 bits of
+    /// state instead of the Mersenne Twister's 19968, which makes it cheap
+    /// to keep one engine per thread. Returns the upper 32 bits of each
+    /// 64 bit output.
+    class Xoshiro256StarStar : public randomtools::UIntRandomNumberGenerator
+    {
+    public:
+        Xoshiro256StarStar(void) { seed(); }
+        unsigned int operator()();
+        inline unsigned int next(void) { return (*this)(); }
+        void seed(unsigned int _Seed = 9U);
+
+    private:
+        unsigned long long s[4];
+
+    private: // methods
+        static inline unsigned long long rotl(unsigned long long x, int k) { return (x << k) | (x >> (64 - k)); }
+    };
+}
+
+#endif //  __XOSHIRO256STARSTAR_H_
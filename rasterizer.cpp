@@ -0,0 +1,432 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QtGlobal>
+#include <QtCore/QDebug>
+#include <qmath.h>
+#include <limits>
+#include "rasterizer.h"
+
+
+static const int FixedOne = 1 << 16;
+static const int SubPixelOne = 1 << Rasterizer::SubPixelBits;
+static const int SubPixelMask = SubPixelOne - 1;
+static const int FullCoverage = SubPixelOne * Rasterizer::SubScanlines;
+
+
+/// fast and exact division by 255 for values in [0..255*255]
+static inline int div255(int x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+
+static inline QRgb blendPixel(QRgb d, int r, int g, int b, int a)
+{
+    const int ia = 255 - a;
+    return qRgba(div255(r * a + qRed(d) * ia),
+                 div255(g * a + qGreen(d) * ia),
+                 div255(b * a + qBlue(d) * ia),
+                 a + div255(qAlpha(d) * ia));
+}
+
+
+template <typename T>
+static inline bool edgeLessThan(const T& a, const T& b)
+{
+    return a.y0 < b.y0;
+}
+
+
+Rasterizer::Rasterizer(QImage* canvas)
+    : mCanvas(NULL)
+    , mBits(NULL)
+    , mStride(0)
+    , mWidth(0)
+    , mHeight(0)
+    , mFillRule(Qt::OddEvenFill)
+    , mSpanMinX(std::numeric_limits<int>::max())
+    , mSpanMaxX(-1)
+    , mMask(NULL)
+    , mMaskStride(0)
+{
+    if (canvas != NULL)
+        setCanvas(canvas);
+}
+
+
+void Rasterizer::setCanvas(QImage* canvas)
+{
+    Q_ASSERT(canvas != NULL);
+    setBand(canvas, canvas->size(), 0);
+}
+
+
+/// draw into a band holding the rows [top, top + band->height()) of an image of the given size
+void Rasterizer::setBand(QImage* band, const QSize& imageSize, int top)
+{
+    Q_ASSERT(band != NULL);
+    Q_ASSERT(band->format() == QImage::Format_ARGB32 || band->format() == QImage::Format_RGB32);
+    Q_ASSERT(band->width() == imageSize.width());
+    mCanvas = band;
+    mBits = reinterpret_cast<QRgb*>(band->bits());
+    mStride = band->bytesPerLine() / sizeof(QRgb);
+    mWidth = imageSize.width();
+    mHeight = imageSize.height();
+    mBandRect = QRect(0, top, mWidth, band->height()) & QRect(0, 0, mWidth, mHeight);
+    mClipRect = mBandRect;
+    if (mCoverage.size() != mWidth + 2) {
+        mCoverage.fill(0, mWidth + 2);
+        mRuns.fill(0, mWidth + 2);
+    }
+}
+
+
+/// prepare for drawCoverage() without a canvas
+void Rasterizer::setImageSize(const QSize& imageSize)
+{
+    mCanvas = NULL;
+    mBits = NULL;
+    mStride = 0;
+    mWidth = imageSize.width();
+    mHeight = imageSize.height();
+    mBandRect = QRect(0, 0, mWidth, mHeight);
+    mClipRect = mBandRect;
+    if (mCoverage.size() != mWidth + 2) {
+        mCoverage.fill(0, mWidth + 2);
+        mRuns.fill(0, mWidth + 2);
+    }
+}
+
+
+void Rasterizer::setClipRect(const QRect& clipRect)
+{
+    mClipRect = clipRect & mBandRect;
+}
+
+
+void Rasterizer::fill(QRgb color)
+{
+    if (mBits == NULL)
+        return;
+    for (int y = mClipRect.top(); y <= mClipRect.bottom(); ++y) {
+        QRgb* p = scanLine(y) + mClipRect.left();
+        QRgb* const pEnd = p + mClipRect.width();
+        while (p < pEnd)
+            *p++ = color;
+    }
+}
+
+
+/// accumulate coverage of the horizontal span [x0, x1) given in 16.16 fixed point
+void Rasterizer::addSpan(int x0, int x1)
+{
+    const int left = mClipRect.left() * FixedOne;
+    const int right = (mClipRect.right() + 1) * FixedOne;
+    if (x0 < left)
+        x0 = left;
+    if (x1 > right)
+        x1 = right;
+    if (x0 >= x1)
+        return;
+    x0 >>= 16 - SubPixelBits;
+    x1 >>= 16 - SubPixelBits;
+    const int i0 = x0 >> SubPixelBits;
+    const int i1 = x1 >> SubPixelBits;
+    int* const coverage = mCoverage.data();
+    if (i0 == i1) {
+        coverage[i0] += x1 - x0;
+    }
+    else {
+        // partially covered pixels at both ends, fully covered pixels in between as a run
+        int* const runs = mRuns.data();
+        coverage[i0] += SubPixelOne - (x0 & SubPixelMask);
+        runs[i0 + 1] += SubPixelOne;
+        runs[i1] -= SubPixelOne;
+        coverage[i1] += x1 & SubPixelMask;
+    }
+    if (i0 < mSpanMinX)
+        mSpanMinX = i0;
+    if (i1 > mSpanMaxX)
+        mSpanMaxX = i1;
+}
+
+
+/// convert the accumulated coverage of a pixel row to alpha values and blend
+/// the current color into the canvas or write the coverage to the mask
+void Rasterizer::blendRow(int y)
+{
+    if (mSpanMaxX < mSpanMinX)
+        return;
+    const int r = mColor.red();
+    const int g = mColor.green();
+    const int b = mColor.blue();
+    const int alpha = mColor.alpha();
+    const int right = mClipRect.right();
+    int* const coverage = mCoverage.data();
+    int* const runs = mRuns.data();
+    QRgb* const line = (mMask == NULL)? scanLine(y) : NULL;
+    uchar* const maskLine = (mMask != NULL)? mMask + (y - mClipRect.top()) * mMaskStride - mClipRect.left() : NULL;
+    int run = 0;
+    for (int x = mSpanMinX; x <= mSpanMaxX; ++x) {
+        run += runs[x];
+        int c = coverage[x] + run;
+        coverage[x] = 0;
+        runs[x] = 0;
+        if (c <= 0 || x > right)
+            continue;
+        if (c > FullCoverage)
+            c = FullCoverage;
+        const int c8 = (c * 255 + FullCoverage / 2) / FullCoverage;
+        if (maskLine != NULL) {
+            maskLine[x] = c8;
+            continue;
+        }
+        const int a = div255(c8 * alpha);
+        if (a > 0)
+            line[x] = blendPixel(line[x], r, g, b, a);
+    }
+    mSpanMinX = std::numeric_limits<int>::max();
+    mSpanMaxX = -1;
+}
+
+
+void Rasterizer::drawPolygon(const QPolygonF& polygon, const QColor& color)
+{
+    if (mBits == NULL || color.alpha() == 0)
+        return;
+    mColor = color;
+    rasterize(polygon.constData(), polygon.size());
+}
+
+
+/// Write the coverage (0..255) of the polygon with n points into a mask whose
+/// top left corner corresponds to the top left corner of the clip rect.
+/// Uncovered pixels are left untouched, so the mask should be cleared beforehand.
+void Rasterizer::drawCoverage(const QPointF* points, int n, uchar* mask, int maskStride)
+{
+    Q_ASSERT(mask != NULL);
+    mMask = mask;
+    mMaskStride = maskStride;
+    rasterize(points, n);
+    mMask = NULL;
+}
+
+
+void Rasterizer::drawCoverage(const QuantizedPoint* points, int n, uchar* mask, int maskStride)
+{
+    Q_ASSERT(mask != NULL);
+    mMask = mask;
+    mMaskStride = maskStride;
+    rasterize(points, n);
+    mMask = NULL;
+}
+
+
+/// blend color into the canvas weighted by a coverage mask as produced by drawCoverage()
+void Rasterizer::blendCoverage(const uchar* mask, const QRect& maskRect, QRgb color)
+{
+    const QRect& area = maskRect & mClipRect;
+    if (mBits == NULL || qAlpha(color) == 0 || area.isEmpty())
+        return;
+    const int r = qRed(color);
+    const int g = qGreen(color);
+    const int b = qBlue(color);
+    const int alpha = qAlpha(color);
+    for (int y = area.top(); y <= area.bottom(); ++y) {
+        const uchar* m = mask + (y - maskRect.top()) * maskRect.width() + area.left() - maskRect.left();
+        QRgb* p = scanLine(y) + area.left();
+        QRgb* const pEnd = p + area.width();
+        for ( ; p < pEnd; ++p, ++m) {
+            if (*m == 0)
+                continue;
+            const int a = div255(*m * alpha);
+            if (a > 0)
+                *p = blendPixel(*p, r, g, b, a);
+        }
+    }
+}
+
+
+/// Set up the edge from p0 to p1 for the sub-scanlines [clipTop, clipBottom).
+/// Returns false if the edge does not cross any of them.
+bool Rasterizer::makeEdge(const QPointF& p0, const QPointF& p1, int clipTop, int clipBottom, Edge& e) const
+{
+    // scale normalized coordinates to pixels horizontally and to sub-scanlines vertically
+    const qreal sx = mWidth;
+    const qreal sy = mHeight * SubScanlines;
+    qreal x0 = p0.x() * sx;
+    qreal y0 = p0.y() * sy;
+    qreal x1 = p1.x() * sx;
+    qreal y1 = p1.y() * sy;
+    int dir = 1;
+    if (y0 > y1) {
+        qSwap(x0, x1);
+        qSwap(y0, y1);
+        dir = -1;
+    }
+    // sub-scanline j is sampled at j+0.5
+    const int jStart = qCeil(y0 - 0.5);
+    const int j0 = qMax(jStart, clipTop);
+    const int j1 = qMin(qCeil(y1 - 0.5), clipBottom);
+    if (j0 >= j1)
+        return false;
+    const qreal slope = (x1 - x0) / (y1 - y0);
+    e.y0 = j0;
+    e.y1 = j1;
+    e.dx = qRound(slope * FixedOne);
+    // step from the unclipped start so that clipping does not change the result
+    e.x = int(qRound((x0 + (jStart + 0.5 - y0) * slope) * FixedOne) + qint64(j0 - jStart) * e.dx);
+    e.dir = dir;
+    return true;
+}
+
+
+/// a/b rounded to the nearest integer, b must be positive
+static inline qint64 divRound(qint64 a, qint64 b)
+{
+    return (a >= 0)? (a + b / 2) / b : -((b / 2 - a) / b);
+}
+
+
+/// Same as above, but in 16.16 fixed point throughout.
+bool Rasterizer::makeEdge(const QuantizedPoint& p0, const QuantizedPoint& p1, int clipTop, int clipBottom, Edge& e) const
+{
+    // scale to 16.16 fixed point pixels horizontally and sub-scanlines vertically
+    const qint64 sx = qint64(mWidth) * FixedOne;
+    const qint64 sy = qint64(mHeight) * SubScanlines * FixedOne;
+    qint64 x0 = p0.qx * sx / QuantizedPoint::One;
+    qint64 y0 = p0.qy * sy / QuantizedPoint::One;
+    qint64 x1 = p1.qx * sx / QuantizedPoint::One;
+    qint64 y1 = p1.qy * sy / QuantizedPoint::One;
+    int dir = 1;
+    if (y0 > y1) {
+        qSwap(x0, x1);
+        qSwap(y0, y1);
+        dir = -1;
+    }
+    // sub-scanline j is sampled at j+0.5, coordinates are not negative
+    const int jStart = int((y0 - FixedOne / 2 + FixedOne - 1) >> 16);
+    const int j0 = qMax(jStart, clipTop);
+    const int j1 = qMin(int((y1 - FixedOne / 2 + FixedOne - 1) >> 16), clipBottom);
+    if (j0 >= j1)
+        return false;
+    const qint64 dx = x1 - x0;
+    const qint64 dy = y1 - y0;
+    e.y0 = j0;
+    e.y1 = j1;
+    e.dx = int(qBound(qint64(std::numeric_limits<int>::min()), divRound(dx * FixedOne, dy), qint64(std::numeric_limits<int>::max())));
+    // step from the unclipped start so that clipping does not change the result
+    const qint64 t = (qint64(jStart) << 16) + FixedOne / 2 - y0;
+    e.x = int(x0 + divRound(dx * t, dy) + qint64(j0 - jStart) * e.dx);
+    e.dir = dir;
+    return true;
+}
+
+
+/// Scan convert the polygon. Convex polygons cross each sub-scanline at
+/// most twice, so with Convex set the crossings need neither sorting nor
+/// a fill rule: the span runs from the leftmost to the rightmost one.
+template <typename T, bool Convex>
+void Rasterizer::scanConvert(const T* points, int n)
+{
+    if (n < 3 || mClipRect.isEmpty())
+        return;
+    const int clipTop = mClipRect.top() * SubScanlines;
+    const int clipBottom = (mClipRect.bottom() + 1) * SubScanlines;
+    int yEnd = clipTop;
+    mEdges.resize(0);
+    for (int i = 0; i < n; ++i) {
+        Edge e;
+        if (!makeEdge(points[i], points[(i + 1) % n], clipTop, clipBottom, e))
+            continue;
+        mEdges.append(e);
+        if (e.y1 > yEnd)
+            yEnd = e.y1;
+    }
+    if (mEdges.isEmpty())
+        return;
+    qSort(mEdges.begin(), mEdges.end(), edgeLessThan<Edge>);
+    Edge* const edges = mEdges.data();
+    const int nEdges = mEdges.size();
+    int nextEdge = 0;
+    mActive.resize(0);
+    mCrossings.resize(nEdges);
+    Crossing* const crossings = mCrossings.data();
+    for (int j = (edges[0].y0 / SubScanlines) * SubScanlines; j < yEnd; ++j) {
+        while (nextEdge < nEdges && edges[nextEdge].y0 <= j)
+            mActive.append(nextEdge++);
+        // collect crossings of active edges with the current sub-scanline, sorted by x
+        int nCrossings = 0;
+        int a = 0;
+        if (Convex) {
+            int x0 = std::numeric_limits<int>::max();
+            int x1 = std::numeric_limits<int>::min();
+            while (a < mActive.size()) {
+                Edge& e = edges[mActive.at(a)];
+                if (e.y1 <= j) {
+                    mActive[a] = mActive.last();
+                    mActive.resize(mActive.size() - 1);
+                    continue;
+                }
+                x0 = qMin(x0, e.x);
+                x1 = qMax(x1, e.x);
+                e.x += e.dx;
+                ++nCrossings;
+                ++a;
+            }
+            if (nCrossings > 1)
+                addSpan(x0, x1);
+            if ((j + 1) % SubScanlines == 0 || j + 1 == yEnd)
+                blendRow(j / SubScanlines);
+            continue;
+        }
+        while (a < mActive.size()) {
+            Edge& e = edges[mActive.at(a)];
+            if (e.y1 <= j) {
+                mActive[a] = mActive.last();
+                mActive.resize(mActive.size() - 1);
+                continue;
+            }
+            int k = nCrossings++;
+            while (k > 0 && crossings[k - 1].x > e.x) {
+                crossings[k] = crossings[k - 1];
+                --k;
+            }
+            crossings[k].x = e.x;
+            crossings[k].dir = e.dir;
+            e.x += e.dx;
+            ++a;
+        }
+        if (mFillRule == Qt::OddEvenFill) {
+            for (int k = 0; k + 1 < nCrossings; k += 2)
+                addSpan(crossings[k].x, crossings[k + 1].x);
+        }
+        else {
+            int winding = 0;
+            int spanStart = 0;
+            for (int k = 0; k < nCrossings; ++k) {
+                const int prevWinding = winding;
+                winding += crossings[k].dir;
+                if (prevWinding == 0 && winding != 0)
+                    spanStart = crossings[k].x;
+                else if (prevWinding != 0 && winding == 0)
+                    addSpan(spanStart, crossings[k].x);
+            }
+        }
+        if ((j + 1) % SubScanlines == 0 || j + 1 == yEnd)
+            blendRow(j / SubScanlines);
+    }
+}
+
+
+/// triangles, which are convex by nature, take the shortcut
+template <typename T>
+void Rasterizer::rasterize(const T* points, int n)
+{
+    if (n == 3)
+        scanConvert<T, true>(points, n);
+    else
+        scanConvert<T, false>(points, n);
+}
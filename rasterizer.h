@@ -0,0 +1,87 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __RASTERIZER_H_
+#define __RASTERIZER_H_
+
+#include <QImage>
+#include <QRgb>
+#include <QRect>
+#include <QColor>
+#include <QVector>
+#include <QPolygonF>
+#include "vertex.h"
+
+
+/// Scanline polygon rasterizer drawing antialiased polygons straight into a QRgb buffer.
+/// Polygon coordinates are expected to be normalized to [0..1], just like in Gene.
+/// Quantized points are turned into edges with integer arithmetic only.
+class Rasterizer
+{
+public:
+    explicit Rasterizer(QImage* canvas = NULL);
+
+    void setCanvas(QImage* canvas);
+    void setBand(QImage* band, const QSize& imageSize, int top);
+    void setImageSize(const QSize& imageSize);
+    void setClipRect(const QRect& clipRect);
+    void setFillRule(Qt::FillRule fillRule) { mFillRule = fillRule; }
+    inline const QRect& clipRect(void) const { return mClipRect; }
+    inline Qt::FillRule fillRule(void) const { return mFillRule; }
+
+    void fill(QRgb color);
+    void drawPolygon(const QPolygonF& polygon, const QColor& color);
+    void drawCoverage(const QPointF* points, int n, uchar* mask, int maskStride);
+    void drawCoverage(const QuantizedPoint* points, int n, uchar* mask, int maskStride);
+    void blendCoverage(const uchar* mask, const QRect& maskRect, QRgb color);
+
+    /// number of sub-scanlines sampled per pixel row
+    static const int SubScanlines = 4;
+    /// horizontal sub-pixel precision in bits
+    static const int SubPixelBits = 8;
+
+private:
+    struct Edge {
+        int y0; // first sub-scanline covered by the edge
+        int y1; // sub-scanline after the last covered one
+        int x; // 16.16 fixed point x coordinate at the current sub-scanline
+        int dx; // 16.16 fixed point increment per sub-scanline
+        int dir; // +1 for downward, -1 for upward edges
+    };
+
+    struct Crossing {
+        int x;
+        int dir;
+    };
+
+    QImage* mCanvas;
+    QRgb* mBits;
+    int mStride;
+    int mWidth;
+    int mHeight;
+    QRect mBandRect;
+    QRect mClipRect;
+    Qt::FillRule mFillRule;
+    QVector<Edge> mEdges;
+    QVector<int> mActive;
+    QVector<Crossing> mCrossings;
+    QVector<int> mCoverage;
+    QVector<int> mRuns;
+    int mSpanMinX;
+    int mSpanMaxX;
+    QColor mColor;
+    uchar* mMask;
+    int mMaskStride;
+
+private: // methods
+    template <typename T> void rasterize(const T* points, int n);
+    template <typename T, bool Convex> void scanConvert(const T* points, int n);
+    bool makeEdge(const QPointF& p0, const QPointF& p1, int clipTop, int clipBottom, Edge& e) const;
+    bool makeEdge(const QuantizedPoint& p0, const QuantizedPoint& p1, int clipTop, int clipBottom, Edge& e) const;
+    void addSpan(int x0, int x1);
+    void blendRow(int y);
+    inline QRgb* scanLine(int y) const { return mBits + (y - mBandRect.top()) * mStride; }
+};
+
+
+#endif // __RASTERIZER_H_
@@ -0,0 +1,174 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QtGlobal>
+#include <QtCore/QDebug>
+#include <QMutexLocker>
+#include "steadystatepool.h"
+#include "random/rnd.h"
+
+
+class SteadyStatePool::Worker : public QThread
+{
+public:
+    Worker(SteadyStatePool* pool, Individual* individual, unsigned int stream)
+        : mPool(pool)
+        , mIndividual(individual)
+        , mStream(stream)
+    { /* ... */ }
+
+protected:
+    void run(void)
+    {
+        RAND::seedThread(mStream);
+        mPool->work(mIndividual);
+    }
+
+private:
+    SteadyStatePool* mPool;
+    Individual* mIndividual;
+    unsigned int mStream;
+};
+
+
+SteadyStatePool::SteadyStatePool(int size)
+    : mIndividuals(size)
+    , mBred(0)
+    , mConflicts(0)
+    , mBusy(0)
+    , mRunning(false)
+    , mQuit(false)
+{
+    Q_ASSERT(size > 0);
+    // the workers hold pointers into mIndividuals, which must therefore never be resized
+    Individual* individual = mIndividuals.data();
+    for (int i = 0; i < size; ++i) {
+        // stream 0 belongs to the thread that set the master seed
+        Worker* worker = new Worker(this, individual++, i + 1);
+        mWorkers.append(worker);
+        worker->start();
+    }
+}
+
+
+SteadyStatePool::~SteadyStatePool()
+{
+    stop();
+    mMutex.lock();
+    mQuit = true;
+    mWake.wakeAll();
+    mMutex.unlock();
+    foreach (Worker* worker, mWorkers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+
+quint64 SteadyStatePool::start(const BreederSettings::Snapshot& settings, const DNA& dna, const QImage& original, const QImage& generated, quint64 fitness)
+{
+    Parent* parent = new Parent;
+    parent->dna = dna;
+    parent->image = generated;
+    parent->fitness = fitness;
+    parent->patched = false;
+    QMutexLocker locker(&mMutex);
+    Q_ASSERT(!mRunning);
+    // the workers tell from the revision whether their DNA is still in sync with the parent
+    parent->revision = mParent.isNull()? 1 : mParent->revision + 1;
+    mParent = QSharedPointer<const Parent>(parent);
+    mSettings = settings;
+    mOriginal = original;
+    mRunning = true;
+    mWake.wakeAll();
+    return parent->revision;
+}
+
+
+void SteadyStatePool::stop(void)
+{
+    QMutexLocker locker(&mMutex);
+    mRunning = false;
+    while (mBusy > 0)
+        mIdle.wait(&mMutex);
+}
+
+
+void SteadyStatePool::setSettings(const BreederSettings::Snapshot& settings)
+{
+    QMutexLocker locker(&mMutex);
+    mSettings = settings;
+}
+
+
+QSharedPointer<const SteadyStatePool::Parent> SteadyStatePool::parent(void) const
+{
+    QMutexLocker locker(&mMutex);
+    return mParent;
+}
+
+
+int SteadyStatePool::takeBred(void)
+{
+    return mBred.fetchAndStoreRelaxed(0);
+}
+
+
+int SteadyStatePool::conflicts(void) const
+{
+    QMutexLocker locker(&mMutex);
+    return mConflicts;
+}
+
+
+void SteadyStatePool::work(Individual* individual)
+{
+    QMutexLocker locker(&mMutex);
+    forever {
+        while (!mRunning && !mQuit)
+            mWake.wait(&mMutex);
+        if (mQuit)
+            break;
+        ++mBusy;
+        while (mRunning) {
+            QSharedPointer<const Parent> parent = mParent;
+            const BreederSettings::Snapshot settings = mSettings;
+            locker.unlock();
+            individual->reset(settings, parent->dna, parent->revision, parent->patched? &parent->patch : NULL, mOriginal, parent->image, parent->fitness);
+            individual->evolve();
+            mBred.fetchAndAddRelaxed(1);
+            if (individual->fitness() < parent->fitness) {
+                individual->updateGenerated();
+                commit(parent, *individual);
+            }
+            // the parent may have been replaced, so this might be the last reference
+            parent.clear();
+            locker.relock();
+        }
+        if (--mBusy == 0)
+            mIdle.wakeAll();
+    }
+}
+
+
+/// Make offspring the new parent unless the parent it has been bred from
+/// has been replaced in the meantime. Returns true on success.
+bool SteadyStatePool::commit(const QSharedPointer<const Parent>& parent, const Individual& offspring)
+{
+    // the offspring's DNA and image become the parent's without being copied
+    Parent* next = new Parent;
+    next->dna = offspring.dna();
+    next->image = offspring.generated();
+    next->fitness = offspring.fitness();
+    next->revision = parent->revision + 1;
+    next->patched = true;
+    next->patch = offspring.patch();
+    const QSharedPointer<const Parent> candidate(next);
+    QMutexLocker locker(&mMutex);
+    if (mParent != parent) {
+        ++mConflicts;
+        return false;
+    }
+    mParent = candidate;
+    return true;
+}
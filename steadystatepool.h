@@ -0,0 +1,84 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __STEADYSTATEPOOL_H_
+#define __STEADYSTATEPOOL_H_
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QImage>
+#include <QVector>
+#include "dna.h"
+#include "individual.h"
+#include "breedersettings.h"
+
+
+/// Threads breeding without a generation barrier. Each worker takes the
+/// current parent, breeds an offspring of it and, if the offspring is
+/// fitter, tries to make it the new parent. The attempt only succeeds if
+/// no other worker has replaced the parent in the meantime (compare and
+/// swap on the parent's revision), because the offspring's changes are
+/// relative to the parent it was bred from. Workers never wait for each
+/// other apart from the few instructions it takes to swap the parent.
+class SteadyStatePool
+{
+public:
+    /// A parent is never modified once it has been handed to the workers.
+    struct Parent {
+        DNA dna;
+        QImage image;
+        quint64 fitness;
+        /// incremented with every commit, never repeats during the pool's lifetime
+        quint64 revision;
+        /// true if patch holds the changes that turned revision-1 into this one
+        bool patched;
+        DNAPatch patch;
+    };
+
+    explicit SteadyStatePool(int size);
+    ~SteadyStatePool();
+
+    inline int size(void) const { return mIndividuals.size(); }
+
+    /// let the workers breed from the given parent until stop() is called, returns the parent's revision
+    quint64 start(const BreederSettings::Snapshot& settings, const DNA& dna, const QImage& original, const QImage& generated, quint64 fitness);
+    /// wait until all workers have finished the offspring they are breeding
+    void stop(void);
+    /// settings to be used for the offsprings bred from now on
+    void setSettings(const BreederSettings::Snapshot& settings);
+
+    /// current parent, safe to call from any thread
+    QSharedPointer<const Parent> parent(void) const;
+    /// number of offsprings bred since the last call
+    int takeBred(void);
+    /// number of fitter offsprings discarded because the parent had changed while they were bred
+    int conflicts(void) const;
+
+private:
+    class Worker;
+
+    QVector<Individual> mIndividuals;
+    QVector<Worker*> mWorkers;
+    /// guards mParent, mSettings and mConflicts
+    mutable QMutex mMutex;
+    QSharedPointer<const Parent> mParent;
+    BreederSettings::Snapshot mSettings;
+    QImage mOriginal;
+    QAtomicInt mBred;
+    int mConflicts;
+    QWaitCondition mWake;
+    QWaitCondition mIdle;
+    int mBusy;
+    bool mRunning;
+    bool mQuit;
+
+private: // methods
+    void work(Individual* individual);
+    bool commit(const QSharedPointer<const Parent>& parent, const Individual& offspring);
+};
+
+
+#endif // __STEADYSTATEPOOL_H_
@@ -7,15 +7,17 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = delaunay
 TEMPLATE = app
 
+INCLUDEPATH += ../..
+
 SOURCES += \
     main.cpp \
     mainwindow.cpp \
-    delaunay.cpp
+    ../../delaunay.cpp
 
 HEADERS += \
     mainwindow.h \
     main.h \
-    delaunay.h
+    ../../delaunay.h
 
 
 FORMS += mainwindow.ui
@@ -16,6 +16,8 @@
 #include <QSettings>
 #include <qmath.h>
 
+using namespace Delaunay;
+
 #ifdef WIN32
 #include <Windows.h>
 
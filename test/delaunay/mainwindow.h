@@ -37,8 +37,8 @@ private: // methods
     void saveSettings(void);
     void restoreSettings(void);
 
-    VertexSet mVertices;
-    TriangleSet mTriangles;
+    Delaunay::VertexSet mVertices;
+    Delaunay::TriangleSet mTriangles;
 };
 
 #endif // __MAINWINDOW_H_
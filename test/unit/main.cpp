@@ -4,10 +4,54 @@
 #include <QCoreApplication>
 #include <QtCore/QDebug>
 #include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
 #include <QTest>
+#include <QSignalSpy>
+#include <cstdlib>
+
+#include "random/rnd.h"
+#include "gene.h"
+#include "dna.h"
+#include "individual.h"
+#include "fitness.h"
+#include "compositecache.h"
+#include "workerpool.h"
+#include "breeder.h"
+#include "island.h"
+#include "helper.h"
+#include "breedersettings.h"
+
+
+#if defined(__GLIBC__)
+// count heap allocations by interposing the C allocator, which Qt's containers and operator new end up in
+#define HAVE_ALLOCATION_COUNTER
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+static long gAllocations = 0;
+
+extern "C" void* malloc(size_t size) __THROW
+{
+    __sync_fetch_and_add(&gAllocations, 1);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) __THROW
+{
+    __sync_fetch_and_add(&gAllocations, 1);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) __THROW
+{
+    __sync_fetch_and_add(&gAllocations, 1);
+    return __libc_realloc(p, size);
+}
+#endif
 
-#include "../../random/rnd.h"
-#include "../../gene.h"
 
 class RNGTest: public QObject
 {
@@ -16,17 +60,26 @@ class RNGTest: public QObject
 private:
     static const int N = 100000;
 
+    static void addEngines(void)
+    {
+        QTest::addColumn<int>("engine");
+        QTest::newRow("MersenneTwister") << (int)RAND::MersenneTwisterEngine;
+        QTest::newRow("xoshiro256**") << (int)RAND::XoshiroEngine;
+    }
+
 private slots:
     void initTestCase()
     {
         qDebug() << "Seeding random number generator ...";
-        rng.seed(QDateTime::currentDateTime().toTime_t());
+        RAND::seed(QDateTime::currentDateTime().toTime_t());
         qDebug() << N << "iterations per test.";
     }
 
-//    void cleanupTestCase()
-//    {
-//    }
+    void cleanupTestCase()
+    {
+        RAND::setEngine(RAND::XoshiroEngine);
+        RAND::seed(QDateTime::currentDateTime().toTime_t());
+    }
 
     void tRandom()
     {
@@ -102,6 +155,1037 @@ private slots:
         }
     }
 
+    void tGeometric()
+    {
+        // the mean number of failures before a success with probability 1/a is a-1
+        const int probabilities[] = { 1, 2, 10, 700 };
+        for (unsigned int i = 0; i < sizeof(probabilities) / sizeof(probabilities[0]); ++i) {
+            const int a = probabilities[i];
+            qreal sum = 0;
+            for (int j = 0; j < N; ++j) {
+                const int gap = RAND::geometric(a);
+                QVERIFY2(gap >= 0, "gap below lower boundary");
+                sum += gap;
+            }
+            const qreal mean = sum / N;
+            QVERIFY2(qAbs(mean - (a - 1)) <= 5 * a / qSqrt(N), "mean gap deviates from expectation");
+        }
+    }
+
+    void tSeeding_data()
+    {
+        addEngines();
+    }
+
+    void tSeeding()
+    {
+        QFETCH(int, engine);
+        RAND::setEngine((RAND::Engine)engine);
+        QVector<unsigned int> stream0, stream1;
+        RAND::seed(4711);
+        for (int i = 0; i < 1000; ++i)
+            stream0.append(RAND::rnd());
+        RAND::seedThread(1);
+        for (int i = 0; i < 1000; ++i)
+            stream1.append(RAND::rnd());
+        QVERIFY2(stream0 != stream1, "streams must differ");
+        RAND::seed(4711);
+        for (int i = 0; i < stream0.size(); ++i)
+            QCOMPARE(RAND::rnd(), stream0.at(i));
+        RAND::seedThread(1);
+        for (int i = 0; i < stream1.size(); ++i)
+            QCOMPARE(RAND::rnd(), stream1.at(i));
+    }
+
+    void bEngine_data()
+    {
+        addEngines();
+    }
+
+    void bEngine()
+    {
+        QFETCH(int, engine);
+        RAND::setEngine((RAND::Engine)engine);
+        RAND::seedThread(0);
+        unsigned int sum = 0;
+        QBENCHMARK {
+            for (int i = 0; i < N; ++i)
+                sum += RAND::rnd();
+        }
+        QVERIFY(sum != 0);
+    }
+
+};
+
+
+static DNA loadDNA(const QString& filename)
+{
+    DNA dna;
+    dna.load(filename);
+    if (dna.scale().isEmpty()) // some older DNA files lack a valid size
+        dna.setScale(QSize(256, 256));
+    return dna;
+}
+
+
+static void addFixtures(bool withRenderer)
+{
+    QTest::addColumn<QString>("filename");
+    if (withRenderer)
+        QTest::addColumn<int>("renderer");
+    const QDir dir(SRCDIR "../dna");
+    const QStringList& files = dir.entryList(QStringList() << "*.dna.json", QDir::Files, QDir::Name);
+    foreach (QString f, files) {
+        if (withRenderer) {
+            QTest::newRow(qPrintable(f + " QPainter")) << dir.absoluteFilePath(f) << (int)QPainterRenderer;
+            QTest::newRow(qPrintable(f + " Scanline")) << dir.absoluteFilePath(f) << (int)ScanlineRenderer;
+        }
+        else {
+            QTest::newRow(qPrintable(f)) << dir.absoluteFilePath(f);
+        }
+    }
+}
+
+
+/// rendering of dna with the given renderer, leaves the renderer setting alone
+static QImage render(const DNA& dna, int renderer)
+{
+    const int previous = gSettings.renderer();
+    gSettings.setRenderer(renderer);
+    // the individual keeps the settings it has been created with
+    Individual individual(dna, QImage(dna.scale(), QImage::Format_ARGB32));
+    gSettings.setRenderer(previous);
+    individual.draw();
+    return individual.generated();
+}
+
+
+/// inverted rendering of the DNA in filename, an original image that leaves breeders a lot to improve
+static QImage invertedOriginal(const QString& filename)
+{
+    QImage original = render(loadDNA(filename), QPainterRenderer);
+    original.invertPixels();
+    return original;
+}
+
+
+static bool sameGenes(const DNA& a, const DNA& b)
+{
+    if (a.size() != b.size() || a.points() != b.points())
+        return false;
+    for (int i = 0; i < a.size(); ++i) {
+        if (a.polygon(i) != b.polygon(i) || a.color(i) != b.color(i) || a.boundingRect(i) != b.boundingRect(i))
+            return false;
+    }
+    return true;
+}
+
+
+class GeneTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    static qreal area(const QPolygonF& polygon)
+    {
+        qreal a = 0;
+        for (int i = 0; i < polygon.size(); ++i) {
+            const QPointF& p = polygon.at(i);
+            const QPointF& q = polygon.at((i + 1) % polygon.size());
+            a += p.x() * q.y() - q.x() * p.y();
+        }
+        return qAbs(a) / 2;
+    }
+
+    static Gene randomGene(int n, int grid = 0)
+    {
+        QPolygonF polygon;
+        for (int i = 0; i < n; ++i) {
+            QPointF p(RAND::rnd1(), RAND::rnd1());
+            if (grid > 0) // provoke cocircular and collinear vertices
+                p = QPointF(qreal(int(p.x() * grid)) / grid, qreal(int(p.y() * grid)) / grid);
+            polygon.append(p);
+        }
+        return Gene(polygon, QColor(Qt::red));
+    }
+
+private slots:
+    void tTriangulize_data()
+    {
+        QTest::addColumn<int>("grid");
+        QTest::newRow("random vertices") << 0;
+        QTest::newRow("vertices on a grid") << 6;
+    }
+
+    /// the triangles must cover the convex hull without overlapping
+    void tTriangulize()
+    {
+        QFETCH(int, grid);
+        for (int i = 0; i < 500; ++i) {
+            const Gene& gene = randomGene(4 + i % 40, grid);
+            const QVector<Gene>& triangles = gene.triangulize();
+            qreal sum = 0;
+            for (QVector<Gene>::const_iterator t = triangles.constBegin(); t != triangles.constEnd(); ++t) {
+                QCOMPARE(t->polygon().size(), 3);
+                sum += area(t->polygon());
+            }
+            QVERIFY(qAbs(sum - area(convexHull(gene.polygon()))) < 1e-9);
+        }
+    }
+
+    void bSplice_data()
+    {
+        QTest::addColumn<int>("n");
+        QTest::newRow("16 vertices") << 16;
+        QTest::newRow("64 vertices") << 64;
+        QTest::newRow("256 vertices") << 256;
+        QTest::newRow("1024 vertices") << 1024;
+    }
+
+    void bSplice()
+    {
+        QFETCH(int, n);
+        const Gene& gene = randomGene(n);
+        QBENCHMARK {
+            gene.splice();
+        }
+    }
+
+};
+
+
+class DNATest: public QObject
+{
+    Q_OBJECT
+
+private:
+    bool mOnlyConvex;
+    int mColorMutationProbability;
+    int mPointMutationProbability;
+    int mGeneMoveProbability;
+
+private slots:
+    void init()
+    {
+        mOnlyConvex = gSettings.onlyConvex();
+        mColorMutationProbability = gSettings.colorMutationProbability();
+        mPointMutationProbability = gSettings.pointMutationProbability();
+        mGeneMoveProbability = gSettings.geneMoveProbability();
+    }
+
+    /// some tests need convex genes or other probabilities, which must not leak into the tests that follow
+    void cleanup()
+    {
+        gSettings.setOnlyConvex(mOnlyConvex);
+        gSettings.setColorMutationProbability(mColorMutationProbability);
+        gSettings.setPointMutationProbability(mPointMutationProbability);
+        gSettings.setGeneMoveProbability(mGeneMoveProbability);
+    }
+
+    void tPatch_data()
+    {
+        addFixtures(false);
+    }
+
+    void tPatch()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QVERIFY2(dna.size() > 2, "DNA could not be loaded");
+        DNA mutated;
+        mutated.assign(dna);
+        DNAPatch patch;
+        for (int i = 0; i < 200; ++i) {
+            mutated.mutate(&patch);
+            DNA patched;
+            patched.assign(dna);
+            patched.apply(patch);
+            QVERIFY(sameGenes(patched, mutated));
+            mutated.revert(patch);
+            QVERIFY(sameGenes(mutated, dna));
+        }
+    }
+
+    void tConvexMutation()
+    {
+        gSettings.setOnlyConvex(true);
+        DNA dna;
+        for (int i = 0; i < 100; ++i)
+            dna.append(Gene(true));
+        for (int i = 0; i < 1000; ++i)
+            dna.mutate();
+        for (int i = 0; i < dna.size(); ++i) {
+            if (dna.vertexCount(i) > 3)
+                QVERIFY(isStrictlyConvex(dna.polygon(i).constData(), dna.vertexCount(i)));
+        }
+    }
+
+    /// genomes of triangles take their own mutation kernel, which must keep them triangles
+    void tTriangleMutation()
+    {
+        BreederSettings::Snapshot settings = gSettings.snapshot();
+        settings.minPointsPerGene = settings.maxPointsPerGene = 3;
+        settings.pointMutationProbability = settings.colorMutationProbability = 10;
+        DNA dna;
+        for (int i = 0; i < 100; ++i)
+            dna.append(Gene(settings));
+        DNAPatch patch;
+        for (int i = 0; i < 1000; ++i) {
+            DNA parent;
+            parent.assign(dna);
+            dna.mutate(settings, &patch);
+            QCOMPARE(dna.points(), 3 * uint(dna.size()));
+            parent.apply(patch);
+            QVERIFY(sameGenes(parent, dna));
+        }
+    }
+
+    /// changing the settings must not affect a mutation that has been handed a snapshot
+    void tSettingsSnapshot()
+    {
+        DNA dna;
+        for (int i = 0; i < 100; ++i)
+            dna.append(Gene(true));
+        const int never = std::numeric_limits<int>::max();
+        BreederSettings::Snapshot settings = gSettings.snapshot();
+        settings.colorMutationProbability = never;
+        settings.pointMutationProbability = never;
+        settings.pointKillProbability = never;
+        settings.pointEmergenceProbability = never;
+        settings.geneKillProbability = never;
+        settings.geneMoveProbability = never;
+        settings.geneEmergenceProbability = never;
+        // mutate everything as far as the global settings are concerned
+        gSettings.setColorMutationProbability(1);
+        gSettings.setPointMutationProbability(1);
+        gSettings.setGeneMoveProbability(1);
+        DNA mutated;
+        mutated.assign(dna);
+        for (int i = 0; i < 20; ++i)
+            mutated.mutate(settings);
+        QVERIFY(sameGenes(mutated, dna));
+    }
+
+    /// DNAs received from other processes must arrive unchanged, invalid genes must be rejected
+    void tStream()
+    {
+        DNA dna;
+        dna.setScale(QSize(320, 240));
+        for (int i = 0; i < 100; ++i)
+            dna.append(Gene(true));
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << dna;
+        DNA received;
+        QDataStream in(data);
+        in >> received;
+        QCOMPARE(in.status(), QDataStream::Ok);
+        QCOMPARE(received.scale(), dna.scale());
+        QVERIFY(sameGenes(received, dna));
+        // a gene of two vertices
+        QByteArray line;
+        QDataStream lineOut(&line, QIODevice::WriteOnly);
+        lineOut << QSize(320, 240) << qint32(1) << quint32(0xff000000U) << qint32(2) << 0.0 << 0.0 << 1.0 << 1.0;
+        QDataStream lineIn(line);
+        lineIn >> received;
+        QCOMPARE(lineIn.status(), QDataStream::ReadCorruptData);
+        QCOMPARE(received.size(), 0);
+        QByteArray nan;
+        QDataStream nanOut(&nan, QIODevice::WriteOnly);
+        nanOut << QSize(320, 240) << qint32(1) << quint32(0xff000000U) << qint32(3) << 0.0 << 0.0 << 1.0 << 1.0 << std::numeric_limits<double>::quiet_NaN() << 0.5;
+        QDataStream nanIn(nan);
+        nanIn >> received;
+        QCOMPARE(nanIn.status(), QDataStream::ReadCorruptData);
+        QCOMPARE(received.size(), 0);
+    }
+
+    /// the grid must agree with a linear scan over the genes after any kind of mutation
+    void tGenesIn()
+    {
+        DNA dna;
+        for (int i = 0; i < 150; ++i)
+            dna.append(Gene(true));
+        QVector<int> genes;
+        for (int i = 0; i < 500; ++i) {
+            dna.mutate();
+            const QPointF p(RAND::rnd1(), RAND::rnd1());
+            const QRectF area(p, QSizeF(0.25 * RAND::rnd1(), 0.25 * RAND::rnd1()));
+            QVector<int> expected;
+            int top = -1;
+            for (int j = 0; j < dna.size(); ++j) {
+                if (dna.boundingRect(j).intersects(area))
+                    expected.append(j);
+                if (dna.boundingRect(j).contains(p) && dna.polygon(j).containsPoint(p, Qt::WindingFill))
+                    top = j;
+            }
+            dna.genesIn(area, genes);
+            QCOMPARE(genes, expected);
+            QCOMPARE(dna.geneAt(p), top);
+        }
+    }
+
+    void bMutate_data()
+    {
+        QTest::addColumn<bool>("onlyConvex");
+        QTest::newRow("any polygons") << false;
+        QTest::newRow("only convex polygons") << true;
+    }
+
+    /// cost of breeding one offspring, apart from rendering
+    void bMutate()
+    {
+        QFETCH(bool, onlyConvex);
+        gSettings.setOnlyConvex(onlyConvex);
+        DNA dna;
+        for (int i = 0; i < 500; ++i)
+            dna.append(Gene(true));
+        DNAPatch patch;
+        QBENCHMARK {
+            dna.mutate(&patch);
+            dna.revert(patch);
+        }
+    }
+
+};
+
+
+class RasterizerTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    int mRenderer;
+
+private slots:
+    void initTestCase()
+    {
+        gSettings.setBackgroundColor(qRgba(255, 255, 255, 255));
+    }
+
+    void init()
+    {
+        mRenderer = gSettings.renderer();
+    }
+
+    /// the tests switch renderers, which must not leak into the tests that follow
+    void cleanup()
+    {
+        gSettings.setRenderer(mRenderer);
+    }
+
+    void tCompareWithQPainter_data()
+    {
+        addFixtures(false);
+    }
+
+    void tCompareWithQPainter()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QVERIFY2(dna.size() > 0, "DNA could not be loaded");
+        const QImage& reference = render(dna, QPainterRenderer);
+        const QImage& scanline = render(dna, ScanlineRenderer);
+        QCOMPARE(scanline.size(), reference.size());
+        quint64 sum = 0;
+        const QRgb* r = reinterpret_cast<const QRgb*>(reference.constBits());
+        const QRgb* s = reinterpret_cast<const QRgb*>(scanline.constBits());
+        const int N = reference.width() * reference.height();
+        for (int i = 0; i < N; ++i, ++r, ++s)
+            sum += qAbs(qRed(*r) - qRed(*s)) + qAbs(qGreen(*r) - qGreen(*s)) + qAbs(qBlue(*r) - qBlue(*s));
+        const qreal meanDelta = (qreal)sum / (3 * N);
+        QVERIFY2(meanDelta < 2.0, "scanline output deviates too much from QPainter output");
+    }
+
+    void tEarlyAbort_data()
+    {
+        addFixtures(false);
+    }
+
+    void tEarlyAbort()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        gSettings.setRenderer(ScanlineRenderer);
+        const QImage& original = render(dna, ScanlineRenderer);
+        Individual parent(dna, original);
+        QCOMPARE(parent.calcFitness(), Q_UINT64_C(0));
+        // nothing can beat a perfect parent, so every visible mutation must be aborted
+        for (int i = 0; i < 20; ++i) {
+            Individual offspring(dna, original, parent.generated(), parent.fitness());
+            offspring.evolve();
+            QVERIFY(offspring.fitness() == 0 || offspring.fitness() == std::numeric_limits<quint64>::max());
+        }
+    }
+
+    void tCoverageMasks_data()
+    {
+        addFixtures(false);
+    }
+
+    void tCoverageMasks()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QImage rasterized(dna.scale(), QImage::Format_ARGB32);
+        QImage blended(dna.scale(), QImage::Format_ARGB32);
+        Rasterizer r1(&rasterized);
+        Rasterizer r2(&blended);
+        r1.fill(gSettings.backgroundColor());
+        r2.fill(gSettings.backgroundColor());
+        for (int i = 0; i < dna.size(); ++i) {
+            r1.drawPolygon(dna.polygon(i), QColor::fromRgba(dna.color(i)));
+            r2.blendCoverage(dna.coverage(i, dna.scale()).constData(), dna.coverageRect(i), dna.color(i));
+        }
+        QVERIFY(rasterized == blended);
+    }
+
+    void tQuantizedCoverage_data()
+    {
+        addFixtures(false);
+    }
+
+    void tQuantizedCoverage()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QVERIFY2(dna.size() > 0, "DNA could not be loaded");
+        Rasterizer r;
+        r.setImageSize(dna.scale());
+        const int maskSize = dna.scale().width() * dna.scale().height();
+        QVector<uchar> exact(maskSize), quantized(maskSize);
+        quint64 coverage = 0, delta = 0;
+        for (int i = 0; i < dna.size(); ++i) {
+            // same polygon, once rasterized from floating point and once from fixed point coordinates
+            const QPolygonF& polygon = dna.polygon(i);
+            QVector<QuantizedPoint> points(polygon.size());
+            QPolygonF rounded(polygon.size());
+            for (int j = 0; j < polygon.size(); ++j)
+                rounded[j] = points[j] = polygon.at(j);
+            exact.fill(0);
+            quantized.fill(0);
+            r.drawCoverage(rounded.constData(), rounded.size(), exact.data(), dna.scale().width());
+            r.drawCoverage(points.constData(), points.size(), quantized.data(), dna.scale().width());
+            for (int j = 0; j < maskSize; ++j) {
+                coverage += exact.at(j);
+                delta += qAbs(exact.at(j) - quantized.at(j));
+            }
+        }
+        QVERIFY(delta * 1000 <= coverage);
+    }
+
+    void tIncrementalFitness_data()
+    {
+        addFixtures(false);
+    }
+
+    void tIncrementalFitness()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        // an inverted original leaves room for improvement
+        QImage original = render(dna, QPainterRenderer);
+        original.invertPixels();
+        gSettings.setRenderer(ScanlineRenderer);
+        Individual parent(dna, original);
+        parent.calcFitness();
+        for (int i = 0; i < 100; ++i) {
+            Individual offspring(parent.dna(), original, parent.generated(), parent.fitness());
+            offspring.evolve();
+            offspring.updateGenerated();
+            Individual reference(offspring.dna(), original);
+            if (offspring.fitness() == std::numeric_limits<quint64>::max()) {
+                // evaluation has been aborted because the offspring is not fitter than its parent
+                QVERIFY(reference.calcFitness() >= parent.fitness());
+                continue;
+            }
+            QCOMPARE(offspring.fitness(), reference.calcFitness());
+            QVERIFY(offspring.generated() == reference.generated());
+            parent = offspring;
+        }
+    }
+
+    void bDraw_data()
+    {
+        addFixtures(true);
+    }
+
+    void bDraw()
+    {
+        QFETCH(QString, filename);
+        QFETCH(int, renderer);
+        const DNA& dna = loadDNA(filename);
+        gSettings.setRenderer(renderer);
+        Individual individual(dna, QImage(dna.scale(), QImage::Format_ARGB32));
+        QBENCHMARK {
+            individual.draw();
+        }
+    }
+
+};
+
+class CompositeCacheTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    int mRenderer;
+
+private slots:
+    void initTestCase()
+    {
+        gSettings.setBackgroundColor(qRgba(255, 255, 255, 255));
+    }
+
+    void init()
+    {
+        mRenderer = gSettings.renderer();
+        gSettings.setRenderer(ScanlineRenderer);
+    }
+
+    void cleanup()
+    {
+        gSettings.setRenderer(mRenderer);
+    }
+
+    void tErrorDelta_data()
+    {
+        addFixtures(false);
+    }
+
+    void tErrorDelta()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QVERIFY2(dna.size() > 2, "DNA could not be loaded");
+        const QImage& original = render(dna, QPainterRenderer);
+        const int imageBytes = 4 * sizeof(float) * original.width() * original.height();
+        CompositeCache full;
+        full.build(dna, original.size(), gSettings.backgroundColor());
+        CompositeCache sparse;
+        sparse.build(dna, original.size(), gSettings.backgroundColor(), 4 * imageBytes);
+        QVERIFY(full.isValid() && sparse.isValid());
+        QVERIFY(sparse.checkpointInterval() > 1);
+        Individual parent(dna, original);
+        parent.calcFitness();
+        for (int i = 0; i < 20; ++i) {
+            const int k = RAND::rnd(dna.size());
+            const Gene& gene = dna.at(k);
+            QPolygonF polygon = gene.polygon();
+            polygon.translate(RAND::rnd1(-0.05, 0.05), RAND::rnd1(-0.05, 0.05));
+            const Gene mutated(polygon, QColor(RAND::rnd(256), RAND::rnd(256), RAND::rnd(256), gene.color().alpha()));
+            DNA offspring(dna);
+            offspring.replace(k, mutated);
+            const QRect& rect = pixelRect(gene.boundingRect() | mutated.boundingRect(), original.size());
+            const qint64 delta = full.errorDelta(original, rect, k, offspring);
+            QCOMPARE(sparse.errorDelta(original, rect, k, offspring), delta);
+            // rounding differs from the rasterizer, so only expect the estimate to be close
+            const qint64 exactDelta = qint64(Individual(offspring, original).calcFitness()) - qint64(parent.fitness());
+            QVERIFY(qAbs(delta - exactDelta) <= 32 * qint64(rect.width()) * rect.height());
+        }
+    }
+
+};
+
+
+class WorkerPoolTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    int mRenderer;
+
+private slots:
+    void initTestCase()
+    {
+        gSettings.setBackgroundColor(qRgba(255, 255, 255, 255));
+    }
+
+    void init()
+    {
+        mRenderer = gSettings.renderer();
+        gSettings.setRenderer(ScanlineRenderer);
+    }
+
+    void cleanup()
+    {
+        gSettings.setRenderer(mRenderer);
+    }
+
+    void tOffspringFitness_data()
+    {
+        addFixtures(false);
+    }
+
+    void tOffspringFitness()
+    {
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QImage original = render(dna, QPainterRenderer);
+        original.invertPixels();
+        Individual parent(dna, original);
+        parent.calcFitness();
+        DNA parentDNA(dna);
+        quint64 revision = 1;
+        DNAPatch selected;
+        const DNAPatch* patch = NULL;
+        const BreederSettings::Snapshot& settings = gSettings.snapshot();
+        WorkerPool pool(4);
+        for (int generation = 0; generation < 10; ++generation) {
+            pool.evolve(settings, parentDNA, revision, patch, original, parent.generated(), parent.fitness());
+            Individual* best = NULL;
+            for (int i = 0; i < pool.size(); ++i) {
+                Individual& offspring = pool.individual(i);
+                if (offspring.fitness() == std::numeric_limits<quint64>::max())
+                    continue;
+                offspring.updateGenerated();
+                QCOMPARE(offspring.fitness(), Individual(offspring.dna(), original).calcFitness());
+                if (offspring.fitness() < parent.fitness() && (best == NULL || offspring.fitness() < best->fitness()))
+                    best = &offspring;
+            }
+            // select like the breeder does, so that the workers have to follow the parent's patches
+            patch = NULL;
+            if (best != NULL) {
+                selected = best->patch();
+                parentDNA.apply(selected);
+                QVERIFY(sameGenes(parentDNA, best->dna()));
+                patch = &selected;
+                ++revision;
+                parent = Individual(parentDNA, original);
+                parent.calcFitness();
+            }
+        }
+    }
+
+    void tNoAllocationsForColorMutations_data()
+    {
+        addFixtures(false);
+    }
+
+    /// generations of color mutations must reuse the workers' buffers, see WorkerPool
+    void tNoAllocationsForColorMutations()
+    {
+#ifndef HAVE_ALLOCATION_COUNTER
+#if QT_VERSION < 0x050000
+        QSKIP("allocations can only be counted with glibc", SkipAll);
+#else
+        QSKIP("allocations can only be counted with glibc");
+#endif
+#else
+        QFETCH(QString, filename);
+        const DNA& dna = loadDNA(filename);
+        QImage original = render(dna, QPainterRenderer);
+        original.invertPixels();
+        Individual parent(dna, original);
+        parent.calcFitness();
+        // Only mutate colors, which keeps polygons and coverage masks as they
+        // are. This is what most generations look like once the DNA has settled.
+        BreederSettings::Snapshot settings = gSettings.snapshot();
+        const int never = std::numeric_limits<int>::max();
+        settings.colorMutationProbability = 10;
+        settings.pointMutationProbability = never;
+        settings.pointKillProbability = never;
+        settings.pointEmergenceProbability = never;
+        settings.geneKillProbability = never;
+        settings.geneMoveProbability = never;
+        settings.geneEmergenceProbability = never;
+        WorkerPool pool(2);
+        // let the buffers grow to their working size
+        for (int generation = 0; generation < 10; ++generation)
+            pool.evolve(settings, parent.dna(), 1, NULL, original, parent.generated(), parent.fitness());
+        const long before = gAllocations;
+        for (int generation = 0; generation < 100; ++generation)
+            pool.evolve(settings, parent.dna(), 1, NULL, original, parent.generated(), parent.fitness());
+        const long allocations = gAllocations - before;
+        QCOMPARE(allocations, 0L);
+#endif
+    }
+
+};
+
+
+class BreederTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    int mRenderer;
+    int mCores;
+
+private slots:
+    void initTestCase()
+    {
+        qRegisterMetaType<DNA>("DNA");
+    }
+
+    void init()
+    {
+        mRenderer = gSettings.renderer();
+        mCores = gSettings.cores();
+        gSettings.setRenderer(ScanlineRenderer);
+    }
+
+    /// some tests need a certain number of cores, which must not leak into the tests that follow
+    void cleanup()
+    {
+        gSettings.setRenderer(mRenderer);
+        gSettings.setCores(mCores);
+    }
+
+    void tPublishedState_data()
+    {
+        addFixtures(false);
+    }
+
+    /// a state handed out by the breeder must stay as it was while breeding goes on
+    void tPublishedState()
+    {
+        QFETCH(QString, filename);
+        const QImage& original = invertedOriginal(filename);
+        Breeder breeder;
+        breeder.setOriginalImage(original);
+        const QSharedPointer<const Breeder::State>& first = breeder.state();
+        DNA firstDNA;
+        firstDNA.assign(first->dna);
+        const quint64 firstFitness = first->fitness;
+        QCOMPARE(firstFitness, breeder.currentFitness());
+        breeder.step(200);
+        QVERIFY(breeder.currentFitness() < firstFitness);
+        QVERIFY(sameGenes(first->dna, firstDNA));
+        QCOMPARE(first->fitness, firstFitness);
+        QCOMPARE(breeder.state()->fitness, breeder.currentFitness());
+        QVERIFY(sameGenes(breeder.state()->dna, breeder.constDNA()));
+    }
+
+    void tCoalescedUpdates_data()
+    {
+        addFixtures(false);
+    }
+
+    /// selections following the previous update too soon are only signalled with the next one
+    void tCoalescedUpdates()
+    {
+        QFETCH(QString, filename);
+        const QImage& original = invertedOriginal(filename);
+        Breeder breeder;
+        breeder.setOriginalImage(original);
+        breeder.setMaximumUpdateRate(1);
+        QSignalSpy evolved(&breeder, SIGNAL(evolved(const QImage&, const DNA&, quint64, unsigned long, unsigned long)));
+        const unsigned long selected = breeder.selected();
+        breeder.step(200);
+        const unsigned long selections = breeder.selected() - selected;
+        QVERIFY(selections > 1);
+        QVERIFY(breeder.coalescedUpdates() > 0);
+        QCOMPARE(ulong(evolved.count()) + breeder.coalescedUpdates(), selections);
+        // the update sent when stepping is done carries the newest state
+        QCOMPARE(evolved.last().at(2).toULongLong(), breeder.currentFitness());
+    }
+
+    void tMergedOffsprings_data()
+    {
+        addFixtures(false);
+    }
+
+    /// offsprings merged into the fittest one must not change each other's fitness
+    void tMergedOffsprings()
+    {
+        QFETCH(QString, filename);
+        const QImage& original = invertedOriginal(filename);
+        gSettings.setCores(8);
+        Breeder breeder;
+        breeder.setOriginalImage(original);
+        breeder.setMergingOffsprings(true);
+        const unsigned long selected = breeder.selected();
+        breeder.step(400);
+        QVERIFY(breeder.mergedOffsprings() > 0);
+        QVERIFY(breeder.selected() - selected > breeder.mergedOffsprings());
+        Individual reference(breeder.constDNA(), original);
+        QCOMPARE(reference.calcFitness(), breeder.currentFitness());
+        QCOMPARE(breeder.image(), reference.generated());
+    }
+
+    void tSteadyState_data()
+    {
+        addFixtures(false);
+    }
+
+    /// offsprings committed concurrently must add up to a DNA whose fitness is the one published
+    void tSteadyState()
+    {
+        QFETCH(QString, filename);
+        const QImage& original = invertedOriginal(filename);
+        gSettings.setCores(4);
+        Breeder breeder;
+        breeder.setOriginalImage(original);
+        const quint64 firstFitness = breeder.currentFitness();
+        const unsigned long firstGeneration = breeder.generation();
+        breeder.setSteadyState(true);
+        breeder.breed();
+        // let enough offsprings be committed concurrently, but do not fail on slow or busy machines
+        QElapsedTimer timer;
+        timer.start();
+        while ((breeder.currentFitness() >= firstFitness || breeder.generation() - firstGeneration < 1000) && timer.elapsed() < 60000)
+            QTest::qWait(20);
+        breeder.stop();
+        breeder.wait();
+        QVERIFY(breeder.generation() > firstGeneration);
+        QVERIFY(breeder.currentFitness() < firstFitness);
+        QCOMPARE(breeder.state()->fitness, breeder.currentFitness());
+        QCOMPARE(Individual(breeder.constDNA(), original).calcFitness(), breeder.currentFitness());
+    }
+
+    void tGenerationLimit_data()
+    {
+        addFixtures(false);
+    }
+
+    /// the breeder must stop by itself within one round of offsprings of its generation limit
+    void tGenerationLimit()
+    {
+        QFETCH(QString, filename);
+        const QImage& original = invertedOriginal(filename);
+        gSettings.setCores(4);
+        Breeder breeder;
+        breeder.setOriginalImage(original);
+        const unsigned long limit = breeder.generation() + 100;
+        breeder.setGenerationLimit(limit);
+        breeder.breed();
+        QVERIFY(breeder.wait(60000));
+        QVERIFY(breeder.generation() >= limit);
+        QVERIFY(breeder.generation() < limit + 4);
+    }
+
+};
+
+
+class IslandTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    int mRenderer;
+
+private slots:
+    void init()
+    {
+        mRenderer = gSettings.renderer();
+        gSettings.setRenderer(ScanlineRenderer);
+    }
+
+    void cleanup()
+    {
+        gSettings.setRenderer(mRenderer);
+    }
+
+    void tMigration_data()
+    {
+        addFixtures(false);
+    }
+
+    /// the DNA of a fitter island must arrive unchanged at the other one
+    void tMigration()
+    {
+        QFETCH(QString, filename);
+        const QImage& original = invertedOriginal(filename);
+        Breeder fit, unfit;
+        fit.setOriginalImage(original);
+        unfit.setOriginalImage(original);
+        Island hub(&fit), island(&unfit);
+        hub.setInterval(1);
+        const QString& name = QString("evo-cubist-test-%1").arg(QCoreApplication::applicationPid());
+        QVERIFY(hub.join(name));
+        QVERIFY(hub.isHub());
+        QVERIFY(island.join(name));
+        QVERIFY(!island.isHub());
+        for (int i = 0; i < 100 && hub.neighbours() == 0; ++i)
+            QTest::qWait(10);
+        QCOMPARE(hub.neighbours(), 1);
+        fit.step(200);
+        QVERIFY(fit.currentFitness() < unfit.currentFitness());
+        QVERIFY(hub.emigrants() > 0);
+        for (int i = 0; i < 100 && unfit.currentFitness() != fit.currentFitness(); ++i)
+            QTest::qWait(10);
+        QVERIFY(island.immigrants() > 0);
+        QCOMPARE(unfit.currentFitness(), fit.currentFitness());
+        QVERIFY(sameGenes(unfit.constDNA(), fit.constDNA()));
+    }
+
+};
+
+
+class FitnessTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    static void fillRandom(QVector<QRgb>& pixels)
+    {
+        for (QVector<QRgb>::iterator p = pixels.begin(); p != pixels.end(); ++p)
+            *p = qRgba(RAND::rnd(256), RAND::rnd(256), RAND::rnd(256), RAND::rnd(256));
+    }
+
+    static void addKernels(void)
+    {
+        QTest::addColumn<int>("kernel");
+        QTest::newRow("Scalar") << (int)ScalarKernel;
+        if (fitnessKernelSupported(SSE2Kernel))
+            QTest::newRow("SSE2") << (int)SSE2Kernel;
+        if (fitnessKernelSupported(AVX2Kernel))
+            QTest::newRow("AVX2") << (int)AVX2Kernel;
+    }
+
+private slots:
+    void tKernelsMatchScalar_data()
+    {
+        addKernels();
+    }
+
+    void tKernelsMatchScalar()
+    {
+        QFETCH(int, kernel);
+        // odd lengths exercise the scalar tail of the vectorized kernels
+        const int lengths[] = { 0, 1, 3, 4, 7, 8, 9, 31, 1000, 65537 };
+        for (unsigned int i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+            QVector<QRgb> a(lengths[i]), b(lengths[i]);
+            fillRandom(a);
+            fillRandom(b);
+            QCOMPARE(rgbDeltaSum(a.constData(), b.constData(), a.size(), (FitnessKernel)kernel),
+                     rgbDeltaSum(a.constData(), b.constData(), a.size(), ScalarKernel));
+        }
+    }
+
+    void tKernelsDoNotOverflow_data()
+    {
+        addKernels();
+    }
+
+    void tKernelsDoNotOverflow()
+    {
+        QFETCH(int, kernel);
+        // maximum delta per pixel, enough pixels to overflow 32 bit lanes
+        const int N = 1 << 20;
+        const QVector<QRgb> black(N, qRgba(0, 0, 0, 255));
+        const QVector<QRgb> white(N, qRgba(255, 255, 255, 0));
+        QCOMPARE(rgbDeltaSum(black.constData(), white.constData(), N, (FitnessKernel)kernel), quint64(N) * 3 * 255 * 255);
+    }
+
+    void bRgbDeltaSum_data()
+    {
+        addKernels();
+    }
+
+    void bRgbDeltaSum()
+    {
+        QFETCH(int, kernel);
+        QVector<QRgb> a(512 * 512), b(512 * 512);
+        fillRandom(a);
+        fillRandom(b);
+        quint64 sum = 0;
+        QBENCHMARK {
+            sum += rgbDeltaSum(a.constData(), b.constData(), a.size(), (FitnessKernel)kernel);
+        }
+        QVERIFY(sum > 0);
+    }
+
 };
 
 #include "main.moc"
@@ -109,10 +1193,36 @@ private slots:
 
 int main(int argc, char* argv[])
 {
-    int ok;
+    // the islands' sockets need an event loop
+    QCoreApplication app(argc, argv);
+    int ok = 0;
 
     RNGTest rngTest;
-    ok = QTest::qExec(&rngTest, argc, argv);
+    ok += QTest::qExec(&rngTest, argc, argv);
+
+    GeneTest geneTest;
+    ok += QTest::qExec(&geneTest, argc, argv);
+
+    DNATest dnaTest;
+    ok += QTest::qExec(&dnaTest, argc, argv);
+
+    RasterizerTest rasterizerTest;
+    ok += QTest::qExec(&rasterizerTest, argc, argv);
+
+    CompositeCacheTest compositeCacheTest;
+    ok += QTest::qExec(&compositeCacheTest, argc, argv);
+
+    WorkerPoolTest workerPoolTest;
+    ok += QTest::qExec(&workerPoolTest, argc, argv);
+
+    BreederTest breederTest;
+    ok += QTest::qExec(&breederTest, argc, argv);
+
+    IslandTest islandTest;
+    ok += QTest::qExec(&islandTest, argc, argv);
+
+    FitnessTest fitnessTest;
+    ok += QTest::qExec(&fitnessTest, argc, argv);
 
     return ok;
 }
@@ -0,0 +1,46 @@
+#!/bin/sh
+
+# Measures how breeding throughput scales with the number of islands.
+# Starts 1, 2 and 4 evo-cubist-cli processes as islands of one another,
+# lets them breed for the given number of seconds and prints the sum of
+# the generations per second they report. Use a settings file with
+# <cores>1</cores> to have one core per island.
+#
+# Usage: island-benchmark.sh CLI IMAGE [SECONDS] [SETTINGS]
+
+cli=$1
+image=$2
+seconds=${3:-30}
+settings=$4
+
+if [ -z "$cli" ] || [ -z "$image" ]; then
+    echo "Usage: $0 CLI IMAGE [SECONDS] [SETTINGS]" >&2
+    exit 1
+fi
+
+opt=""
+if [ -n "$settings" ]; then
+    opt="-settings $settings"
+fi
+
+tmp=`mktemp -d`
+
+# islands can only scale up to the number of processors
+echo "`getconf _NPROCESSORS_ONLN` processor(s)"
+
+for n in 1 2 4; do
+    i=0
+    while [ $i -lt $n ]; do
+        "$cli" $opt -island "island-benchmark-$$-$n" -timeout $seconds "$image" > $tmp/$n-$i.log &
+        i=`expr $i + 1`
+    done
+    wait
+    total=0
+    for log in $tmp/$n-*.log; do
+        gps=`grep '"done"' $log | sed -n 's/.*"generationsPerSecond"[ ]*:[ ]*\([0-9]*\).*/\1/p'`
+        total=`expr $total + ${gps:-0}`
+    done
+    echo "$n island(s): $total generations per second"
+done
+
+rm -rf $tmp
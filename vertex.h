@@ -0,0 +1,45 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __VERTEX_H_
+#define __VERTEX_H_
+
+#include <QtGlobal>
+#include <QPointF>
+
+
+/// Point with normalized coordinates stored as 16 bit fixed point numbers,
+/// 0 meaning 0.0 and One meaning 1.0. At a quarter of the size of a
+/// QPointF it is precise enough for images up to 65535 pixels wide or
+/// high. Coordinates outside [0..1] are clamped.
+class QuantizedPoint
+{
+public:
+    inline QuantizedPoint(void) : qx(0), qy(0) { /* ... */ }
+    inline QuantizedPoint(const QPointF& p) : qx(quantize(p.x())), qy(quantize(p.y())) { /* ... */ }
+    inline operator QPointF() const { return QPointF(x(), y()); }
+
+    inline qreal x(void) const { return qreal(qx) / One; }
+    inline qreal y(void) const { return qreal(qy) / One; }
+
+    static const int One = 65535;
+
+    quint16 qx;
+    quint16 qy;
+
+private:
+    static inline quint16 quantize(qreal v) { return quint16(qRound(qBound(qreal(0.0), v, qreal(1.0)) * One)); }
+};
+
+Q_DECLARE_TYPEINFO(QuantizedPoint, Q_PRIMITIVE_TYPE);
+
+
+/// type of the vertices stored in a DNA, see QUANTIZED_COORDINATES in evo-cubist-lib.pro and evo-cubist-lib.pri
+#ifdef QUANTIZED_COORDINATES
+typedef QuantizedPoint Vertex;
+#else
+typedef QPointF Vertex;
+#endif
+
+
+#endif // __VERTEX_H_
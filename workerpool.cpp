@@ -0,0 +1,112 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#include <QtGlobal>
+#include <QtCore/QDebug>
+#include <QMutexLocker>
+#include "workerpool.h"
+#include "random/rnd.h"
+
+
+class WorkerPool::Worker : public QThread
+{
+public:
+    Worker(WorkerPool* pool, Individual* individual, unsigned int stream)
+        : mPool(pool)
+        , mIndividual(individual)
+        , mStream(stream)
+    { /* ... */ }
+
+protected:
+    void run(void)
+    {
+        // a random number generator of its own keeps the workers from contending for a shared one
+        RAND::seedThread(mStream);
+        mPool->work(mIndividual);
+    }
+
+private:
+    WorkerPool* mPool;
+    Individual* mIndividual;
+    unsigned int mStream;
+};
+
+
+WorkerPool::WorkerPool(int size)
+    : mIndividuals(size)
+    , mGeneration(0)
+    , mBusy(0)
+    , mQuit(false)
+    , mSettings(NULL)
+    , mDNA(NULL)
+    , mRevision(0)
+    , mPatch(NULL)
+    , mOriginal(NULL)
+    , mParent(NULL)
+    , mParentFitness(0)
+    , mCache(NULL)
+{
+    Q_ASSERT(size > 0);
+    // the workers hold pointers into mIndividuals, which must therefore never be resized
+    Individual* individual = mIndividuals.data();
+    for (int i = 0; i < size; ++i) {
+        // stream 0 belongs to the thread that set the master seed
+        Worker* worker = new Worker(this, individual++, i + 1);
+        mWorkers.append(worker);
+        worker->start();
+    }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+    mMutex.lock();
+    mQuit = true;
+    mStart.wakeAll();
+    mMutex.unlock();
+    foreach (Worker* worker, mWorkers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+
+/// let each worker breed an offspring of the given parent and wait until all of them have been evaluated
+void WorkerPool::evolve(const BreederSettings::Snapshot& settings, const DNA& dna, quint64 revision, const DNAPatch* patch, const QImage& original, const QImage& parent, quint64 parentFitness, const CompositeCache* cache)
+{
+    QMutexLocker locker(&mMutex);
+    mSettings = &settings;
+    mDNA = &dna;
+    mRevision = revision;
+    mPatch = patch;
+    mOriginal = &original;
+    mParent = &parent;
+    mParentFitness = parentFitness;
+    mCache = cache;
+    mBusy = mWorkers.size();
+    ++mGeneration;
+    mStart.wakeAll();
+    while (mBusy > 0)
+        mDone.wait(&mMutex);
+}
+
+
+void WorkerPool::work(Individual* individual)
+{
+    unsigned long generation = 0;
+    mMutex.lock();
+    forever {
+        while (generation == mGeneration && !mQuit)
+            mStart.wait(&mMutex);
+        if (mQuit)
+            break;
+        generation = mGeneration;
+        mMutex.unlock();
+        individual->reset(*mSettings, *mDNA, mRevision, mPatch, *mOriginal, *mParent, mParentFitness, mCache);
+        individual->evolve();
+        mMutex.lock();
+        if (--mBusy == 0)
+            mDone.wakeAll();
+    }
+    mMutex.unlock();
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2012 Oliver Lau <oliver@von-und-fuer-lau.de>
+// All rights reserved.
+
+#ifndef __WORKERPOOL_H_
+#define __WORKERPOOL_H_
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QVector>
+#include "dna.h"
+#include "individual.h"
+#include "compositecache.h"
+
+
+/// Threads that live as long as the pool, each of them breeding one
+/// offspring per generation. Every worker keeps its Individual across
+/// generations, so the offspring's DNA, render band and rasterizer buffers
+/// are reused instead of being reallocated. As long as the caller passes
+/// the revision of the parent's DNA and the patch that led to it (see
+/// Individual::reset()), the workers do not even copy the parent's DNA.
+/// Once the buffers have grown to their working size, evolve() does not
+/// allocate as long as the mutations only change colors. Changes to the
+/// geometry of a gene allocate its new coverage mask, and the breeder
+/// allocates whenever it selects an offspring.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int size);
+    ~WorkerPool();
+
+    inline int size(void) const { return mIndividuals.size(); }
+    /// offspring bred by worker i in the last call to evolve()
+    inline Individual& individual(int i) { return mIndividuals[i]; }
+
+    void evolve(const BreederSettings::Snapshot& settings, const DNA& dna, quint64 revision, const DNAPatch* patch, const QImage& original, const QImage& parent, quint64 parentFitness, const CompositeCache* cache = NULL);
+
+private:
+    class Worker;
+
+    QVector<Individual> mIndividuals;
+    QVector<Worker*> mWorkers;
+    QMutex mMutex;
+    QWaitCondition mStart;
+    QWaitCondition mDone;
+    unsigned long mGeneration;
+    int mBusy;
+    bool mQuit;
+    // parent of the current generation, only valid while evolve() is running
+    const BreederSettings::Snapshot* mSettings;
+    const DNA* mDNA;
+    quint64 mRevision;
+    const DNAPatch* mPatch;
+    const QImage* mOriginal;
+    const QImage* mParent;
+    quint64 mParentFitness;
+    const CompositeCache* mCache;
+
+private: // methods
+    void work(Individual* individual);
+};
+
+
+#endif // __WORKERPOOL_H_